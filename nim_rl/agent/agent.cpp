@@ -17,36 +17,69 @@
 
 namespace nim_rl {
 
+Agent &Agent::operator=(const Agent &rhs) {
+  current_state_ = rhs.current_state_;
+  return *this;
+}
+
 Agent &Agent::operator=(Agent &&rhs) noexcept {
   current_state_ = std::move(rhs.current_state_);
+  arena_ = rhs.arena_;
   return *this;
 }
 
 Action Agent::Step(Game *game, bool is_evaluation) {
-  Action action = Policy(game->GetState(), is_evaluation);
+  Action action;
+  {
+    NIM_RL_TIME(policy_seconds);
+    action = Policy(game->GetState(), is_evaluation);
+  }
   game->Step(action);
   return action;
 }
 
+void Agent::GetActionProbs(const State &, bool, ActionProbs *) {
+  throw std::logic_error("Agent does not expose its action probabilities.");
+}
+
+void AddUniformProbs(const std::vector<Action> &actions, double prob,
+                     ActionProbs *probs) {
+  for (const auto &action : actions)
+    probs->emplace_back(action, prob / actions.size());
+}
+
 Action SampleAction(const std::vector<Action> &actions) {
-  static std::mt19937 rng{std::random_device{}()};
   if (actions.empty()) {
     return Action{};
   } else {
-    std::uniform_int_distribution<decltype(actions.size())>
-        dist(0, actions.size() - 1);
-    return actions[dist(rng)];
+    return actions[RandomEngine().Bounded(actions.size())];
   }
 }
 
+Action SampleAction(const State &state) {
+  int num_legal_actions = state.NumLegalActions();
+  if (!num_legal_actions) return Action{};
+  auto index = static_cast<int>(RandomEngine().Bounded(num_legal_actions));
+  int pile_id = 0;
+  while (index >= static_cast<int>(state[pile_id]))
+    index -= static_cast<int>(state[pile_id++]);
+  return Action{pile_id, index + 1};
+}
+
 State SampleState(const std::vector<State> &states) {
-  static std::mt19937 rng{std::random_device{}()};
   if (states.empty()) {
     return State{};
   } else {
-    std::uniform_int_distribution<decltype(states.size())>
-        dist(0, states.size() - 1);
-    return states[dist(rng)];
+    return states[RandomEngine().Bounded(states.size())];
+  }
+}
+
+State SampleState(const StateRange &states) {
+  if (!states.Size()) {
+    return State{};
+  } else {
+    return states.Unrank(states.GetBeginRank()
+                         + RandomEngine().Bounded(states.Size()));
   }
 }
 
@@ -21,14 +21,17 @@
 #include <iomanip>
 #include <iostream>
 #include <memory>
-#include <random>
 #include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "nim_rl/action/action.h"
+#include "nim_rl/memory/arena.h"
+#include "nim_rl/random/rng.h"
 #include "nim_rl/state/state.h"
+#include "nim_rl/state/state_range.h"
+#include "nim_rl/stats/stats.h"
 
 namespace std {
 using nim_rl::State;
@@ -48,10 +51,21 @@ struct hash<std::pair<State, Action>> {
 
 namespace nim_rl {
 
+// Actions paired with the probabilities of choosing them.
+using ActionProbs = std::vector<std::pair<Action, double>>;
+
+// Adds the actions to probs, splitting prob evenly between them.
+void AddUniformProbs(const std::vector<Action> &, double prob,
+                     ActionProbs *probs);
+
 Action SampleAction(const std::vector<Action> &);
 
+Action SampleAction(const State &);
+
 State SampleState(const std::vector<State> &);
 
+State SampleState(const StateRange &);
+
 class Game;
 
 class Agent : public std::enable_shared_from_this<Agent> {
@@ -61,17 +75,31 @@ class Agent : public std::enable_shared_from_this<Agent> {
   using Reward = double;
   using Value = double;
   Agent() = default;
-  Agent(const Agent &) = default;
+  // The arena follows the containers allocated from it: moves share it,
+  // while copies, whose containers are on the heap, keep their own.
+  Agent(const Agent &agent)
+      : std::enable_shared_from_this<Agent>(),
+        current_state_(agent.current_state_) {}
   Agent(Agent &&agent) noexcept
-      : current_state_(std::move(agent.current_state_)) {}
-  Agent &operator=(const Agent &) = default;
+      : std::enable_shared_from_this<Agent>(),
+        current_state_(std::move(agent.current_state_)),
+        arena_(agent.arena_) {}
+  Agent &operator=(const Agent &);
   Agent &operator=(Agent &&) noexcept;
   virtual ~Agent() = default;
   virtual std::shared_ptr<Agent> Clone() const = 0;
-  State GetCurrentState() const { return current_state_; }
+  // Fills probs with the distribution Policy draws its action from in the
+  // state, where an action may appear more than once, or clears it in a
+  // terminal state. Throws std::logic_error unless the agent overrides it.
+  virtual void GetActionProbs(const State &, bool is_evaluation,
+                              ActionProbs *probs);
+  const State &GetCurrentState() const { return current_state_; }
   virtual void Initialize(const std::vector<State> &) {}
   virtual Action Policy(const State &, bool is_evaluation) = 0;
-  virtual void Reset() { current_state_ = State(); }
+  // Whether Initialize needs every state of the game. Game::Train skips the
+  // enumeration when neither player does.
+  virtual bool RequiresAllStates() const { return true; }
+  virtual void Reset() { current_state_.Clear(); }
   void SetCurrentState(const State &state) { current_state_ = state; }
   virtual Action Step(Game *, bool is_evaluation);
   virtual void Update(const State &update_state, const State &current_state,
@@ -79,6 +107,19 @@ class Agent : public std::enable_shared_from_this<Agent> {
 
  protected:
   State current_state_;
+  // Shared with the game, so that the agent's containers stay valid if it
+  // outlives the game.
+  std::shared_ptr<Arena> arena_;
+  // Rebuilds the containers the agent keeps in its arena on the new one.
+  virtual void BindArena(Arena *) {}
+
+ private:
+  // The old arena is released only after the containers left it.
+  void SetArena(std::shared_ptr<Arena> arena) {
+    std::shared_ptr<Arena> old_arena = std::move(arena_);
+    arena_ = std::move(arena);
+    BindArena(arena_.get());
+  }
 };
 
 }  // namespace nim_rl
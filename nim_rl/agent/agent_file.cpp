@@ -0,0 +1,274 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/agent/agent_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace nim_rl {
+
+namespace {
+
+constexpr std::size_t kPageSize = 4096;
+constexpr std::uint32_t kByteOrder = 0x01020304;
+constexpr std::size_t kChunkSize = 1 << 16;
+
+struct Hyperparameter {
+  char name[56];
+  double value;
+};
+
+std::size_t RoundUp(std::size_t size, std::size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+std::size_t ValueSize(AgentFile::ValueType value_type) {
+  return value_type == AgentFile::ValueType::kFloat32 ? sizeof(float)
+                                                      : sizeof(double);
+}
+
+template<typename T>
+void WriteValues(std::ofstream *out, const StateRange &state_range,
+                 const ValueTable &table) {
+  std::vector<T> chunk;
+  chunk.reserve(kChunkSize);
+  for (const auto &state : state_range) {
+    chunk.push_back(static_cast<T>(table.Get(state)));
+    if (chunk.size() == kChunkSize) {
+      out->write(reinterpret_cast<const char *>(chunk.data()),
+                 chunk.size() * sizeof(T));
+      chunk.clear();
+    }
+  }
+  out->write(reinterpret_cast<const char *>(chunk.data()),
+             chunk.size() * sizeof(T));
+}
+
+void Pad(std::ofstream *out, std::size_t alignment) {
+  std::size_t size = static_cast<std::size_t>(out->tellp());
+  std::vector<char> padding(RoundUp(size, alignment) - size);
+  out->write(padding.data(), padding.size());
+}
+
+}  // namespace
+
+struct AgentFile::Header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint32_t value_type;
+  std::uint32_t num_piles;
+  std::uint32_t num_tables;
+  std::uint32_t num_hyperparameters;
+  std::uint32_t has_policy;
+  std::uint32_t reserved;
+  std::uint64_t num_values;
+  std::uint64_t data_offset;
+  char agent_type[64];
+  // Followed by the piles of the initial state, as std::uint32_t, and the
+  // hyperparameters, 8-byte aligned.
+  std::size_t HyperparametersOffset() const {
+    return RoundUp(sizeof(Header) + num_piles * sizeof(std::uint32_t), 8);
+  }
+};
+
+constexpr char AgentFile::kMagic[8];
+constexpr std::uint32_t AgentFile::kVersion;
+
+AgentFile::AgentFile(const std::string &path)
+    : file_(std::make_shared<MappedFile>(path, sizeof(Header),
+                                         MappedFile::Mode::kCopyOnWrite)),
+      header_(reinterpret_cast<const Header *>(file_->GetData())) {
+  if (std::memcmp(header_->magic, kMagic, sizeof(kMagic)))
+    throw std::runtime_error(path + " is not an agent file.");
+  if (header_->version != kVersion || header_->byte_order != kByteOrder
+      || header_->value_type
+          > static_cast<std::uint32_t>(ValueType::kFloat32))
+    throw std::runtime_error(path + " has an unsupported version.");
+  std::size_t file_size = file_->GetSize();
+  if (file_size < header_->data_offset)
+    throw std::runtime_error(path + " is truncated.");
+  if (header_->HyperparametersOffset()
+          + header_->num_hyperparameters * sizeof(Hyperparameter)
+      > header_->data_offset)
+    throw std::runtime_error(path + " is corrupt.");
+  state_range_ = StateRange(GetInitialState());
+  if (header_->num_values != state_range_.Size())
+    throw std::runtime_error(path + " is corrupt.");
+  // Bounding the counts first keeps the sizes below from overflowing.
+  std::size_t table_size =
+      RoundUp(header_->num_values * ValueSize(GetValueType()), kPageSize);
+  if (header_->num_values > file_size
+      || header_->num_tables > (file_size - header_->data_offset) / table_size)
+    throw std::runtime_error(path + " is truncated.");
+  std::size_t size = PolicyOffset()
+      + (HasPolicy() ? header_->num_values * 2 * sizeof(std::int32_t) : 0);
+  if (file_size < size) throw std::runtime_error(path + " is truncated.");
+}
+
+void AgentFile::Write(const std::string &path, const std::string &agent_type,
+                      const State &initial_state,
+                      const Hyperparameters &hyperparameters,
+                      const std::vector<const ValueTable *> &tables,
+                      const Policy *policy, ValueType value_type) {
+  StateRange state_range(initial_state);
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrder;
+  header.value_type = static_cast<std::uint32_t>(value_type);
+  header.num_piles = static_cast<std::uint32_t>(initial_state.Size());
+  header.num_tables = static_cast<std::uint32_t>(tables.size());
+  header.num_hyperparameters =
+      static_cast<std::uint32_t>(hyperparameters.size());
+  header.has_policy = policy != nullptr;
+  header.num_values = state_range.Size();
+  header.data_offset = RoundUp(
+      header.HyperparametersOffset()
+          + hyperparameters.size() * sizeof(Hyperparameter), kPageSize);
+  agent_type.copy(header.agent_type, sizeof(header.agent_type) - 1);
+
+  std::vector<char> head(header.data_offset);
+  std::memcpy(head.data(), &header, sizeof(header));
+  auto *piles =
+      reinterpret_cast<std::uint32_t *>(head.data() + sizeof(header));
+  for (int pile_id = 0; pile_id != initial_state.Size(); ++pile_id)
+    piles[pile_id] = initial_state[pile_id];
+  std::sort(piles, piles + initial_state.Size());
+  auto *entry = reinterpret_cast<Hyperparameter *>(
+      head.data() + header.HyperparametersOffset());
+  for (const auto &kv : hyperparameters) {
+    kv.first.copy(entry->name, sizeof(entry->name) - 1);
+    (entry++)->value = kv.second;
+  }
+
+  // Written next to the destination and renamed over it, so readers never
+  // see half a file.
+  std::string tmp_path = path + ".tmp";
+  std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+  out.write(head.data(), head.size());
+  for (const auto *table : tables) {
+    if (value_type == ValueType::kFloat32) {
+      WriteValues<float>(&out, state_range, *table);
+    } else {
+      WriteValues<double>(&out, state_range, *table);
+    }
+    Pad(&out, kPageSize);
+  }
+  if (policy) {
+    std::vector<std::int32_t> actions;
+    actions.reserve(2 * kChunkSize);
+    for (const auto &state : state_range) {
+      auto iter = policy->find(state);
+      Action action = iter != policy->end() ? iter->second : Action();
+      actions.push_back(action.GetPileId());
+      actions.push_back(action.GetNumObjects());
+      if (actions.size() == 2 * kChunkSize) {
+        out.write(reinterpret_cast<const char *>(actions.data()),
+                  actions.size() * sizeof(std::int32_t));
+        actions.clear();
+      }
+    }
+    out.write(reinterpret_cast<const char *>(actions.data()),
+              actions.size() * sizeof(std::int32_t));
+  }
+  out.close();
+  if (!out || std::rename(tmp_path.c_str(), path.c_str())) {
+    std::remove(tmp_path.c_str());
+    throw std::runtime_error("Cannot write " + path);
+  }
+}
+
+Action AgentFile::GetAction(Rank rank) const {
+  auto *actions = reinterpret_cast<const std::int32_t *>(file_->GetData()
+                                                         + PolicyOffset());
+  return Action(actions[2 * rank], actions[2 * rank + 1]);
+}
+
+std::string AgentFile::GetAgentType() const {
+  return std::string(header_->agent_type,
+                     strnlen(header_->agent_type,
+                             sizeof(header_->agent_type)));
+}
+
+AgentFile::Hyperparameters AgentFile::GetHyperparameters() const {
+  Hyperparameters hyperparameters;
+  auto *entry = reinterpret_cast<const Hyperparameter *>(
+      file_->GetData() + header_->HyperparametersOffset());
+  for (std::uint32_t i = 0; i != header_->num_hyperparameters; ++i, ++entry)
+    hyperparameters[std::string(entry->name, strnlen(entry->name,
+                                                     sizeof(entry->name)))]
+        = entry->value;
+  return hyperparameters;
+}
+
+State AgentFile::GetInitialState() const {
+  auto *piles = reinterpret_cast<const std::uint32_t *>(header_ + 1);
+  return State(std::vector<unsigned>(piles, piles + header_->num_piles));
+}
+
+const void *AgentFile::GetTableData(int table) const {
+  if (table < 0 || table >= NumTables())
+    throw std::out_of_range("Table is out of range.");
+  return file_->GetData() + TableOffset(table);
+}
+
+ValueTable::Value AgentFile::GetValue(int table, Rank rank) const {
+  const void *data = GetTableData(table);
+  if (GetValueType() == ValueType::kFloat32)
+    return static_cast<const float *>(data)[rank];
+  return static_cast<const double *>(data)[rank];
+}
+
+AgentFile::ValueType AgentFile::GetValueType() const {
+  return static_cast<ValueType>(header_->value_type);
+}
+
+bool AgentFile::HasPolicy() const { return header_->has_policy; }
+
+int AgentFile::NumTables() const {
+  return static_cast<int>(header_->num_tables);
+}
+
+void AgentFile::ReadPolicy(Policy *policy) const {
+  if (!HasPolicy()) throw std::runtime_error("Agent file has no policy.");
+  policy->clear();
+  policy->reserve(state_range_.Size());
+  for (auto iter = state_range_.begin(); iter != state_range_.end(); ++iter)
+    (*policy)[*iter] = GetAction(iter.GetRank());
+}
+
+void AgentFile::ReadTable(int table, ValueTable *values) const {
+  if (table < 0 || table >= NumTables())
+    throw std::out_of_range("Table is out of range.");
+  values->MapCopyOnWrite(file_, TableOffset(table), GetInitialState(),
+                         GetValueType() == ValueType::kFloat32
+                             ? Precision::kFloat32 : Precision::kFloat64);
+}
+
+std::size_t AgentFile::TableOffset(int table) const {
+  return header_->data_offset
+      + table * RoundUp(header_->num_values * ValueSize(GetValueType()),
+                        kPageSize);
+}
+
+std::size_t AgentFile::PolicyOffset() const {
+  return TableOffset(NumTables());
+}
+
+}  // namespace nim_rl
@@ -0,0 +1,86 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_AGENT_AGENT_FILE_H_
+#define NIM_RL_AGENT_AGENT_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nim_rl/action/action.h"
+#include "nim_rl/agent/value_table.h"
+#include "nim_rl/memory/mapped_file.h"
+#include "nim_rl/state/state.h"
+#include "nim_rl/state/state_range.h"
+
+namespace nim_rl {
+
+// A trained agent on disk: a header naming the agent type, its
+// hyperparameters and the initial state, followed by one dense value array
+// per value table in the rank order of the initial state's StateRange, and
+// optionally an action per state. The arrays start on page boundaries, so an
+// opened file reads them straight from its mapping. Opening a file checks
+// every region of the header against the file size before reading it.
+class AgentFile {
+ public:
+  using Hyperparameters = std::map<std::string, double>;
+  using Policy = std::unordered_map<State, Action>;
+  using Rank = StateRange::Rank;
+  enum class ValueType : std::uint32_t { kFloat64, kFloat32 };
+  static constexpr char kMagic[8] = {'N', 'I', 'M', 'A', 'G', 'E', 'N', 'T'};
+  static constexpr std::uint32_t kVersion = 1;
+  explicit AgentFile(const std::string &path);
+  AgentFile(const AgentFile &) = delete;
+  AgentFile &operator=(const AgentFile &) = delete;
+  ~AgentFile() = default;
+  static void Write(const std::string &path, const std::string &agent_type,
+                    const State &initial_state,
+                    const Hyperparameters &hyperparameters,
+                    const std::vector<const ValueTable *> &tables,
+                    const Policy *policy = nullptr,
+                    ValueType value_type = ValueType::kFloat64);
+  Action GetAction(Rank rank) const;
+  std::string GetAgentType() const;
+  Hyperparameters GetHyperparameters() const;
+  State GetInitialState() const;
+  const StateRange &GetStateRange() const { return state_range_; }
+  // The table's values in rank order, typed by GetValueType.
+  const void *GetTableData(int table) const;
+  ValueTable::Value GetValue(int table, Rank rank) const;
+  ValueType GetValueType() const;
+  bool HasPolicy() const;
+  int NumTables() const;
+  void ReadPolicy(Policy *policy) const;
+  // Replaces the values of a table with the file's array, mapped
+  // copy-on-write, so no value is read until it is looked up.
+  void ReadTable(int table, ValueTable *values) const;
+
+ private:
+  struct Header;
+  // Shared with the tables read from it, which may outlive the AgentFile.
+  std::shared_ptr<MappedFile> file_;
+  const Header *header_;
+  StateRange state_range_;
+  std::size_t TableOffset(int table) const;
+  std::size_t PolicyOffset() const;
+};
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_AGENT_AGENT_FILE_H_
@@ -0,0 +1,287 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/agent/dense_values.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+namespace nim_rl {
+
+namespace {
+
+// An entry referenced by operator[] must survive the next access, so the
+// cache always holds a few entries.
+constexpr std::size_t kMinCacheCapacity = 16;
+
+std::size_t DataOffset(std::size_t header_size) {
+  return (header_size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+}
+
+// IEEE 754 binary16, rounding to nearest even.
+std::uint16_t FloatToHalf(float value) {
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000);
+  int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+  std::uint32_t mantissa = bits & 0x7fffff;
+  if (exponent >= 31) {
+    bool is_nan = (bits & 0x7fffffff) > 0x7f800000;
+    return sign | (is_nan ? 0x7e00 : 0x7c00);
+  }
+  int shift = 13;
+  if (exponent <= 0) {
+    if (exponent < -10) return sign;
+    mantissa |= 0x800000;
+    shift = 14 - exponent;
+    exponent = 0;
+  }
+  std::uint32_t half = (static_cast<std::uint32_t>(exponent) << 10)
+      + (mantissa >> shift);
+  std::uint32_t remainder = mantissa & ((1u << shift) - 1);
+  std::uint32_t halfway = 1u << (shift - 1);
+  // A carry out of the mantissa correctly bumps the exponent.
+  if (remainder > halfway || (remainder == halfway && (half & 1))) ++half;
+  return sign | static_cast<std::uint16_t>(half);
+}
+
+float HalfToFloat(std::uint16_t half) {
+  float sign = half & 0x8000 ? -1.0f : 1.0f;
+  int exponent = (half >> 10) & 0x1f;
+  int mantissa = half & 0x3ff;
+  if (exponent == 0)
+    return sign * std::ldexp(static_cast<float>(mantissa), -24);
+  if (exponent == 31) return mantissa ? std::nanf("") : sign * INFINITY;
+  return sign * std::ldexp(static_cast<float>(mantissa | 0x400),
+                           exponent - 25);
+}
+
+std::size_t CacheCapacity(std::size_t cache_capacity, std::size_t size) {
+  if (cache_capacity == kDefaultValueCacheCapacity)
+    cache_capacity = std::min(size / 8, kMaxDefaultValueCacheCapacity);
+  return std::max(cache_capacity, kMinCacheCapacity);
+}
+
+}  // namespace
+
+constexpr char DenseValues::kMagic[8];
+constexpr std::uint32_t DenseValues::kVersion;
+
+DenseValues::DenseValues(const State &initial_state, Precision precision,
+                         Value scale, std::size_t cache_capacity)
+    : state_range_(initial_state),
+      num_piles_(initial_state.Size()),
+      precision_(precision),
+      scale_(scale),
+      memory_(new char[state_range_.Size() * ValueSize(precision)]()),
+      cache_capacity_(CacheCapacity(cache_capacity, state_range_.Size())) {
+  data_ = memory_.get();
+  entries_.reserve(std::min<Rank>(cache_capacity_, Size()));
+  slots_.reserve(std::min<Rank>(cache_capacity_, Size()));
+}
+
+DenseValues::DenseValues(const std::string &path, const State &initial_state,
+                         Precision precision, Value scale,
+                         std::size_t cache_capacity)
+    : state_range_(initial_state),
+      num_piles_(initial_state.Size()),
+      precision_(precision),
+      scale_(scale),
+      cache_capacity_(CacheCapacity(cache_capacity, state_range_.Size())) {
+  std::size_t header_size = sizeof(Header) + num_piles_ * sizeof(std::uint32_t);
+  std::size_t data_offset = DataOffset(header_size);
+  std::vector<std::uint32_t> piles(num_piles_);
+  for (int pile_id = 0; pile_id != num_piles_; ++pile_id)
+    piles[pile_id] = initial_state[pile_id];
+  std::sort(piles.begin(), piles.end());
+  // An existing file is checked through a read-only mapping before the
+  // writable one, which must not touch a file of something else. It keeps
+  // its precision, which decides its size.
+  if (std::ifstream(path)) {
+    MappedFile existing(path, header_size, MappedFile::Mode::kReadOnly);
+    const auto *header =
+        reinterpret_cast<const Header *>(existing.GetData());
+    const auto *header_piles =
+        reinterpret_cast<const std::uint32_t *>(header + 1);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic))
+        || header->version != kVersion || header->num_piles != num_piles_
+        || header->num_values != state_range_.Size()
+        || header->data_offset != data_offset
+        || header->precision > static_cast<std::uint32_t>(Precision::kInt8)
+        || !std::equal(piles.begin(), piles.end(), header_piles))
+      throw std::runtime_error(
+          path + " does not hold values for this initial state.");
+    precision_ = static_cast<Precision>(header->precision);
+    scale_ = header->scale;
+  }
+  file_.reset(new MappedFile(
+      path, data_offset + state_range_.Size() * ValueSize(precision_)));
+  if (file_->IsCreated()) {
+    auto *header = reinterpret_cast<Header *>(file_->GetData());
+    std::memcpy(header->magic, kMagic, sizeof(kMagic));
+    header->version = kVersion;
+    header->num_piles = static_cast<std::uint32_t>(num_piles_);
+    header->num_values = state_range_.Size();
+    header->data_offset = data_offset;
+    header->precision = static_cast<std::uint32_t>(precision_);
+    header->scale = scale_;
+    std::copy(piles.begin(), piles.end(),
+              reinterpret_cast<std::uint32_t *>(header + 1));
+  }
+  data_ = file_->GetData() + data_offset;
+  entries_.reserve(std::min<Rank>(cache_capacity_, Size()));
+  slots_.reserve(std::min<Rank>(cache_capacity_, Size()));
+}
+
+DenseValues::DenseValues(std::shared_ptr<MappedFile> file, std::size_t offset,
+                         const State &initial_state, Precision precision,
+                         std::size_t cache_capacity)
+    : state_range_(initial_state),
+      num_piles_(initial_state.Size()),
+      precision_(precision),
+      scale_(1.0),
+      file_(std::move(file)),
+      cache_capacity_(CacheCapacity(cache_capacity, state_range_.Size())) {
+  if (file_->GetMode() != MappedFile::Mode::kCopyOnWrite)
+    throw std::invalid_argument("File should be mapped copy-on-write.");
+  if (offset > file_->GetSize()
+      || (file_->GetSize() - offset) / ValueSize(precision_) < Size())
+    throw std::runtime_error(file_->GetPath() + " is truncated.");
+  data_ = file_->GetData() + offset;
+  entries_.reserve(std::min<Rank>(cache_capacity_, Size()));
+  slots_.reserve(std::min<Rank>(cache_capacity_, Size()));
+}
+
+DenseValues::~DenseValues() { WriteBack(); }
+
+void DenseValues::Clear() {
+  entries_.clear();
+  slots_.clear();
+  head_ = tail_ = kNull;
+  std::memset(data_, 0, Size() * ValueSize(precision_));
+}
+
+void DenseValues::Flush() {
+  WriteBack();
+  if (file_) file_->Flush();
+}
+
+bool DenseValues::Find(const State &state, Rank *rank) const {
+  // Agents also see the empty state, which no initial state reaches.
+  if (state.Size() != num_piles_) return false;
+  *rank = state_range_.RankOf(state);
+  return true;
+}
+
+const std::string &DenseValues::GetPath() const {
+  if (!file_) throw std::runtime_error("Values are not mapped.");
+  return file_->GetPath();
+}
+
+DenseValues::Value &DenseValues::operator[](Rank rank) {
+  Entry &entry = entries_[Access(rank)];
+  entry.is_dirty = true;
+  return entry.value;
+}
+
+std::size_t DenseValues::Access(Rank rank) {
+  std::size_t slot;
+  auto iter = slots_.find(rank);
+  if (iter != slots_.end()) {
+    slot = iter->second;
+    if (slot == head_) return slot;
+    Unlink(slot);
+  } else {
+    if (entries_.size() < cache_capacity_) {
+      slot = entries_.size();
+      entries_.emplace_back();
+    } else {
+      slot = tail_;
+      Unlink(slot);
+      const Entry &evicted = entries_[slot];
+      if (evicted.is_dirty) Store(evicted.rank, evicted.value);
+      slots_.erase(evicted.rank);
+    }
+    entries_[slot].rank = rank;
+    entries_[slot].value = Load(rank);
+    entries_[slot].is_dirty = false;
+    slots_.emplace(rank, slot);
+  }
+  entries_[slot].prev = kNull;
+  entries_[slot].next = head_;
+  if (head_ != kNull) entries_[head_].prev = slot;
+  head_ = slot;
+  if (tail_ == kNull) tail_ = slot;
+  return slot;
+}
+
+DenseValues::Value DenseValues::Load(Rank rank) const {
+  switch (precision_) {
+    case Precision::kFloat32:
+      return reinterpret_cast<const float *>(data_)[rank];
+    case Precision::kFloat16:
+      return HalfToFloat(reinterpret_cast<const std::uint16_t *>(data_)[rank]);
+    case Precision::kInt8:
+      return reinterpret_cast<const std::int8_t *>(data_)[rank] * scale_;
+    default:
+      return reinterpret_cast<const double *>(data_)[rank];
+  }
+}
+
+void DenseValues::Store(Rank rank, Value value) {
+  switch (precision_) {
+    case Precision::kFloat32:
+      reinterpret_cast<float *>(data_)[rank] = static_cast<float>(value);
+      break;
+    case Precision::kFloat16:
+      reinterpret_cast<std::uint16_t *>(data_)[rank] =
+          FloatToHalf(static_cast<float>(value));
+      break;
+    case Precision::kInt8:
+      reinterpret_cast<std::int8_t *>(data_)[rank] = static_cast<std::int8_t>(
+          std::max(-127.0, std::min(127.0, std::round(value / scale_))));
+      break;
+    default:
+      reinterpret_cast<double *>(data_)[rank] = value;
+  }
+}
+
+void DenseValues::Unlink(std::size_t slot) {
+  const Entry &entry = entries_[slot];
+  if (entry.prev != kNull) {
+    entries_[entry.prev].next = entry.next;
+  } else {
+    head_ = entry.next;
+  }
+  if (entry.next != kNull) {
+    entries_[entry.next].prev = entry.prev;
+  } else {
+    tail_ = entry.prev;
+  }
+}
+
+void DenseValues::WriteBack() {
+  for (auto &entry : entries_) {
+    if (entry.is_dirty) {
+      Store(entry.rank, entry.value);
+      entry.is_dirty = false;
+    }
+  }
+}
+
+}  // namespace nim_rl
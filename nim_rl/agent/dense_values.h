@@ -0,0 +1,158 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_AGENT_DENSE_VALUES_H_
+#define NIM_RL_AGENT_DENSE_VALUES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nim_rl/memory/mapped_file.h"
+#include "nim_rl/state/state.h"
+#include "nim_rl/state/state_range.h"
+
+namespace nim_rl {
+
+// The default cache capacity of 0 sizes the cache to an eighth of the table,
+// but to at most kMaxDefaultValueCacheCapacity entries.
+constexpr std::size_t kDefaultValueCacheCapacity = 0;
+constexpr std::size_t kMaxDefaultValueCacheCapacity = 1 << 16;
+
+// How a DenseValues stores each value. kInt8 stores round(value / scale).
+enum class Precision : std::uint32_t { kFloat64, kFloat32, kFloat16, kInt8 };
+
+// One value per state of an initial state's StateRange, stored densely by
+// rank, either in memory or in a memory-mapped file. A file written here can
+// be reopened by any later process with the same initial state.
+//
+// Writes go through a bounded LRU cache of double precision values. They stay
+// in the cache until the entry is evicted or Flush is called, so the hot
+// states that every episode updates accumulate their updates at full
+// precision and, when mapped, do not keep dirtying pages of the file. Get
+// reads the cache or the array without changing either, so concurrent Gets
+// are safe as long as nothing writes.
+class DenseValues {
+ public:
+  using Rank = StateRange::Rank;
+  using Value = double;
+  static constexpr char kMagic[8] = {'N', 'I', 'M', 'V', 'A', 'L', 'U', 'E'};
+  static constexpr std::uint32_t kVersion = 2;
+  DenseValues(const State &initial_state, Precision precision,
+              Value scale = 1.0,
+              std::size_t cache_capacity = kDefaultValueCacheCapacity);
+  // Maps the file at path, whose precision and scale win over the given ones
+  // if it already exists.
+  DenseValues(const std::string &path, const State &initial_state,
+              Precision precision = Precision::kFloat64, Value scale = 1.0,
+              std::size_t cache_capacity = kDefaultValueCacheCapacity);
+  // Reads the values from offset on in a file mapped copy-on-write, such as
+  // the arrays of an agent file, which it shares. Only the pages it reads
+  // are loaded, and writes stay in memory.
+  DenseValues(std::shared_ptr<MappedFile> file, std::size_t offset,
+              const State &initial_state, Precision precision,
+              std::size_t cache_capacity = kDefaultValueCacheCapacity);
+  DenseValues(const DenseValues &) = delete;
+  DenseValues &operator=(const DenseValues &) = delete;
+  ~DenseValues();
+  static std::size_t ValueSize(Precision precision);
+  void Clear();
+  void Flush();
+  // Whether the state belongs to this table, setting *rank if it does.
+  bool Find(const State &state, Rank *rank) const;
+  Value Get(Rank rank) const {
+    auto iter = slots_.find(rank);
+    return iter != slots_.end() ? entries_[iter->second].value : Load(rank);
+  }
+  const std::string &GetPath() const;
+  Precision GetPrecision() const { return precision_; }
+  Value GetScale() const { return scale_; }
+  const StateRange &GetStateRange() const { return state_range_; }
+  // Whether the table did not exist before, so it holds zeros.
+  bool IsCreated() const { return !file_ || file_->IsCreated(); }
+  // Whether the values are in a file that writes reach.
+  bool IsMapped() const {
+    return file_ && file_->GetMode() == MappedFile::Mode::kReadWrite;
+  }
+  // Hints the processor to load the stored value of rank, which Get and
+  // operator[] read unless the value is cached.
+  void Prefetch(Rank rank) const {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(data_ + rank * ValueSize(precision_));
+#endif
+  }
+  Rank Size() const { return state_range_.Size(); }
+  // Reference to the cached value, which is written back on eviction. It
+  // stays valid until the cache has evicted one more entry.
+  Value &operator[](Rank rank);
+
+ private:
+  struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t num_piles;
+    std::uint64_t num_values;
+    std::uint64_t data_offset;
+    std::uint32_t precision;
+    std::uint32_t reserved;
+    double scale;
+  };
+  struct Entry {
+    Rank rank;
+    Value value;
+    bool is_dirty;
+    std::size_t prev;
+    std::size_t next;
+  };
+  static constexpr std::size_t kNull = static_cast<std::size_t>(-1);
+  StateRange state_range_;
+  std::size_t num_piles_;
+  Precision precision_;
+  Value scale_;
+  std::shared_ptr<MappedFile> file_;
+  std::unique_ptr<char[]> memory_;
+  char *data_ = nullptr;
+  // Entries form a doubly linked list from the most to the least recently
+  // used, threaded through indices so that hits never allocate.
+  std::vector<Entry> entries_;
+  std::unordered_map<Rank, std::size_t> slots_;
+  std::size_t cache_capacity_;
+  std::size_t head_ = kNull;
+  std::size_t tail_ = kNull;
+  std::size_t Access(Rank rank);
+  Value Load(Rank rank) const;
+  void Store(Rank rank, Value value);
+  void Unlink(std::size_t slot);
+  void WriteBack();
+};
+
+inline std::size_t DenseValues::ValueSize(Precision precision) {
+  switch (precision) {
+    case Precision::kFloat32:
+      return sizeof(float);
+    case Precision::kFloat16:
+      return sizeof(std::uint16_t);
+    case Precision::kInt8:
+      return sizeof(std::int8_t);
+    default:
+      return sizeof(double);
+  }
+}
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_AGENT_DENSE_VALUES_H_
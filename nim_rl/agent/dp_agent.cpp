@@ -15,17 +15,20 @@
 #include "nim_rl/agent/dp_agent.h"
 #include "nim_rl/agent/optimal_agent.h"
 #include "nim_rl/environment/game.h"
+#include "nim_rl/stats/tracer.h"
 
 namespace nim_rl {
 
 void DPAgent::Initialize(const std::vector<State> &all_states) {
+  NIM_RL_TRACE("DPModel");
   OptimalAgent optimal_agent;
+  std::vector<Action> legal_actions;
   for (const auto &state : all_states) {
     if (state.IsTerminal()) {
       (*values_)[state] = kWinReward;
     } else {
       (*values_)[state] = kTieReward;
-      std::vector<Action> legal_actions = state.LegalActions();
+      state.LegalActions(&legal_actions);
       legal_actions.emplace_back();
       for (const auto &action : legal_actions) {
         State next_state = state.Child(action);
@@ -34,22 +37,32 @@ void DPAgent::Initialize(const std::vector<State> &all_states) {
           possibilities.emplace_back(
               next_state.Child(optimal_agent.Policy(next_state, true)), 1.0);
         } else {
-          std::vector<Action> next_legal_actions = next_state.LegalActions();
-          double prob = 1.0 / next_legal_actions.size();
-          for (const auto &next_legal_action : next_legal_actions)
-            possibilities.emplace_back(next_state.Child(next_legal_action),
-                                       prob);
+          double prob = 1.0 / next_state.NumLegalActions();
+          for (const auto &child : next_state.ChildrenView())
+            possibilities.emplace_back(child, prob);
         }
-        transitions_[{state, action}] = possibilities;
+        transitions_[{state, action}] = std::move(possibilities);
       }
     }
   }
 }
 
+void PolicyIterationAgent::GetActionProbs(const State &state,
+                                          bool is_evaluation,
+                                          ActionProbs *probs) {
+  if (is_evaluation || state.IsTerminal()) {
+    DPAgent::GetActionProbs(state, is_evaluation, probs);
+    return;
+  }
+  probs->clear();
+  auto iter = policy_.find(state);
+  probs->emplace_back(iter != policy_.end() ? iter->second : Action{}, 1.0);
+}
+
 void PolicyIterationAgent::Initialize(const std::vector<State> &all_states) {
   DPAgent::Initialize(all_states);
   for (const auto &state : all_states)
-    policy_[state] = SampleAction(state.LegalActions());
+    policy_[state] = SampleAction(state);
   PolicyIteration(all_states);
 }
 
@@ -59,16 +72,20 @@ void PolicyIterationAgent::PolicyIteration(const
   bool policy_stable = false;
   while (!policy_stable) {
     double delta;
+    int sweep = 0;
     do {
+      NIM_RL_TRACE("PolicyEvaluationSweep", "sweep", sweep++);
       delta = 0.0;
       for (const auto &state : all_states) {
         if (state.IsTerminal()) continue;
         Value value = 0.0;
-        auto possibilities = transitions_[{state, Action()}];
+        const auto &possibilities = transitions_[{state, Action()}];
         for (const auto &outcome : possibilities) {
           Reward reward = outcome.first.IsTerminal() ? kLoseReward : kTieReward;
-          value += outcome.second * (reward + gamma_
-              * (*values_)[outcome.first.Child(Policy(outcome.first, false))]);
+          State next_state =
+              outcome.first.Child(Policy(outcome.first, false));
+          value +=
+              outcome.second * (reward + gamma_ * values_->Get(next_state));
         }
         Value *stored_value = &(*values_)[state];
         delta = std::max(delta, std::abs(*stored_value - value));
@@ -76,17 +93,17 @@ void PolicyIterationAgent::PolicyIteration(const
       }
     } while (delta > threshold_);
     policy_stable = true;
-    for (const auto &state : all_states) {
-      if (state.IsTerminal()) continue;
-      Action old_action = policy_[state];
-      std::vector<Action> legal_actions = state.LegalActions();
-      policy_[state] =
-          *std::max_element(legal_actions.begin(), legal_actions.end(),
-                            [&](const Action &a1, const Action &a2) {
-                              return (*values_)[state.Child(a1)]
-                                  < (*values_)[state.Child(a2)];
-                            });
-      if (old_action != policy_[state]) policy_stable = false;
+    {
+      NIM_RL_TRACE("PolicyImprovement", "step", step);
+      std::vector<Action> greedy_actions;
+      for (const auto &state : all_states) {
+        if (state.IsTerminal()) continue;
+        Action old_action = policy_[state];
+        int num_greedy_actions;
+        GreedyValue(state, &num_greedy_actions, &greedy_actions);
+        policy_[state] = greedy_actions.front();
+        if (old_action != policy_[state]) policy_stable = false;
+      }
     }
     std::cout << std::fixed << std::setprecision(kPrecision) << "Epoch "
               << ++step << ": Policy Iteration agent optimal actions ratio: "
@@ -103,15 +120,16 @@ void ValueIterationAgent::ValueIteration(const std::vector<State> &all_states) {
   int step = 0;
   double delta;
   do {
+    NIM_RL_TRACE("ValueIterationSweep", "sweep", step);
     delta = 0.0;
     for (const auto &state : all_states) {
       if (state.IsTerminal()) continue;
       Value value = 0.0;
-      auto possibilities = transitions_[{state, Action()}];
+      const auto &possibilities = transitions_[{state, Action()}];
       for (const auto &outcome : possibilities) {
         Reward reward = outcome.first.IsTerminal() ? kLoseReward : kTieReward;
         value += outcome.second * (reward + gamma_
-            * (*values_)[outcome.first.Child(Policy(outcome.first, false))]);
+            * values_->Get(outcome.first.Child(Policy(outcome.first, false))));
       }
       Value *stored_value = &(*values_)[state];
       delta = std::max(delta, std::abs(*stored_value - value));
@@ -34,16 +34,31 @@ class DPAgent : public RLAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new DPAgent(*this));
   }
+  std::string GetType() const override { return "DPAgent"; }
   double GetGamma() const { return gamma_; }
+  Hyperparameters GetHyperparameters() const override {
+    return {{"gamma", gamma_}, {"threshold", threshold_}};
+  }
   double GetThreshold() const { return threshold_; }
   std::unordered_map<StateAction, std::vector<StateProb>>
   GetTransitions() const { return transitions_; }
   void Initialize(const std::vector<State> &) override;
+  // Sweeps need every state regardless of lazy mode.
+  bool RequiresAllStates() const override { return true; }
   Action PolicyImpl(const std::vector<Action> &/*legal_actions*/,
                     const std::vector<Action> &greedy_actions) override {
     return SampleAction(greedy_actions);
   }
+  void PolicyImplProbs(const std::vector<Action> &/*legal_actions*/,
+                       const std::vector<Action> &greedy_actions,
+                       ActionProbs *probs) const override {
+    AddUniformProbs(greedy_actions, 1.0, probs);
+  }
   void SetGamma(double gamma) { gamma_ = gamma; }
+  void SetHyperparameters(const Hyperparameters &hyperparameters) override {
+    gamma_ = hyperparameters.at("gamma");
+    threshold_ = hyperparameters.at("threshold");
+  }
   void SetThreshold(double threshold) { threshold_ = threshold; }
   template<typename T>
   void SetTransitions(T &&transitions) {
@@ -69,6 +84,10 @@ class PolicyIterationAgent : public DPAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new PolicyIterationAgent(*this));
   }
+  // Outside evaluation the improved policy, like Policy.
+  void GetActionProbs(const State &, bool is_evaluation,
+                      ActionProbs *probs) override;
+  std::string GetType() const override { return "PolicyIterationAgent"; }
   Action Policy(const State &state, bool is_evaluation) override {
     return is_evaluation ? DPAgent::Policy(state, is_evaluation)
                          : policy_[state];
@@ -77,7 +96,12 @@ class PolicyIterationAgent : public DPAgent {
 
  private:
   std::unordered_map<State, Action> policy_;
+  const AgentFile::Policy *GetPolicyMap() const override { return &policy_; }
   void PolicyIteration(const std::vector<State> &);
+  void Read(const AgentFile &file) override {
+    DPAgent::Read(file);
+    file.ReadPolicy(&policy_);
+  }
 };
 
 class ValueIterationAgent : public DPAgent {
@@ -93,6 +117,7 @@ class ValueIterationAgent : public DPAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new ValueIterationAgent(*this));
   }
+  std::string GetType() const override { return "ValueIterationAgent"; }
   void Initialize(const std::vector<State> &) override;
 
  private:
@@ -31,6 +31,7 @@ class HumanAgent : public Agent {
     return std::shared_ptr<Agent>(new HumanAgent(*this));
   }
   Action Policy(const State &, bool is_evaluation) override;
+  bool RequiresAllStates() const override { return false; }
 };
 
 }  // namespace nim_rl
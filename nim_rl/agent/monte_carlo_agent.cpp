@@ -19,9 +19,12 @@ namespace nim_rl {
 
 void MonteCarloAgent::Initialize(const std::vector<State> &all_states) {
   RLAgent::Initialize(all_states);
-  for (const auto &kv : *values_) {
-    cumulative_sums_[kv.first] = 0.0;
-  }
+  cumulative_sums_.clear();
+}
+
+void MonteCarloAgent::BindArena(Arena *arena) {
+  RLAgent::BindArena(arena);
+  trajectory_ = Trajectory(ArenaAllocator<TimeStep>(arena));
 }
 
 void MonteCarloAgent::Reset() {
@@ -34,9 +37,13 @@ Action MonteCarloAgent::Step(Game *game, bool is_evaluation) {
     std::get<2>(trajectory_.back()) = -game->GetReward();
   State state = game->GetState();
   Action action = Agent::Step(game, is_evaluation);
-  trajectory_.emplace_back(state, action, game->GetReward());
-  if (game->GetState().IsTerminal() || game->GetState().IsEmpty())
+  trajectory_.emplace_back(std::move(state), action, game->GetReward());
+  const State &next_state = game->GetState();
+  if (next_state.IsTerminal() || next_state.IsEmpty()) {
+    NIM_RL_COUNT(updates);
+    NIM_RL_TIME(update_seconds);
     Update(State(), State(), 0);
+  }
   return action;
 }
 
@@ -58,16 +65,22 @@ void MonteCarloAgent::Update(const State &/*update_state*/,
                        }) == trajectory_.crend()) {
         ++cumulative_sums_[next_state];
         (*values_)[next_state] +=
-            (ret - (*values_)[next_state]) / cumulative_sums_[next_state];
+            (ret - values_->Get(next_state)) / cumulative_sums_[next_state];
       }
     }
   }
 }
 
+void MonteCarloAgent::UpdateEpisode(const std::vector<TimeStep> &time_steps) {
+  trajectory_ = Trajectory(time_steps.begin(), time_steps.end());
+  Update(State(), State(), 0);
+  trajectory_.clear();
+}
+
 Action ESMonteCarloAgent::Step(Game *game, bool is_evaluation) {
   if (!is_evaluation && game->GetState() == game->GetInitialState()) {
-    State start_state = SampleState(game->GetAllStates());
-    Action start_action = SampleAction(start_state.LegalActions());
+    State start_state = SampleState(game->GetStateRange());
+    Action start_action = SampleAction(start_state);
     game->SetState(start_state);
     game->Step(start_action);
     trajectory_.emplace_back(start_state, start_action, game->GetReward());
@@ -77,13 +90,46 @@ Action ESMonteCarloAgent::Step(Game *game, bool is_evaluation) {
   }
 }
 
+RLAgent::Hyperparameters
+OffPolicyMonteCarloAgent::GetHyperparameters() const {
+  Hyperparameters hyperparameters = MonteCarloAgent::GetHyperparameters();
+  hyperparameters["epsilon"] = epsilon_greedy_.GetEpsilon();
+  hyperparameters["epsilon_decay_factor"] =
+      epsilon_greedy_.GetEpsilonDecayFactor();
+  hyperparameters["importance_sampling"] =
+      static_cast<double>(importance_sampling_);
+  hyperparameters["min_epsilon"] = epsilon_greedy_.GetMinEpsilon();
+  return hyperparameters;
+}
+
+void OffPolicyMonteCarloAgent::SetHyperparameters(
+    const Hyperparameters &hyperparameters) {
+  MonteCarloAgent::SetHyperparameters(hyperparameters);
+  epsilon_greedy_.SetEpsilon(hyperparameters.at("epsilon"));
+  epsilon_greedy_.SetEpsilonDecayFactor(
+      hyperparameters.at("epsilon_decay_factor"));
+  importance_sampling_ = static_cast<ImportanceSampling>(
+      static_cast<int>(hyperparameters.at("importance_sampling")));
+  epsilon_greedy_.SetMinEpsilon(hyperparameters.at("min_epsilon"));
+}
+
 void OffPolicyMonteCarloAgent::Update(const State &/*update_state*/,
                                       const State &/*current_state*/,
                                       Reward /*reward*/) {
   double ret = 0.0, weight = 1.0;
   double epsilon = epsilon_greedy_.GetEpsilon();
-  std::shared_ptr<Values> behavior_policy_values =
-      std::make_shared<Values>(*values_);
+  // Values of the behavior policy are the values before this update, so only
+  // the entries overwritten below need to be remembered.
+  std::unordered_map<State, Value, std::hash<State>, std::equal_to<State>,
+                     ArenaAllocator<std::pair<const State, Value>>>
+      overwritten_values(0, std::hash<State>(), std::equal_to<State>(),
+                         ArenaAllocator<std::pair<const State, Value>>(
+                             arena_.get()));
+  auto behavior_policy_value_of = [&](const State &state) {
+    auto iter = overwritten_values.find(state);
+    return iter != overwritten_values.end() ? iter->second
+                                            : values_->Get(state);
+  };
   for (auto r_iter = trajectory_.crbegin(); r_iter != trajectory_.crend();
        ++r_iter) {
     const State &state = std::get<0>(*r_iter);
@@ -91,49 +137,28 @@ void OffPolicyMonteCarloAgent::Update(const State &/*update_state*/,
     const Action &action = std::get<1>(*r_iter);
     const State &next_state = state.Child(action);
     ret = gamma_ * ret + std::get<2>(*r_iter);
+    overwritten_values.emplace(next_state, values_->Get(next_state));
     if (importance_sampling_ == ImportanceSampling::kNormal) {
       ++cumulative_sums_[next_state];
       (*values_)[next_state] +=
-          (weight * ret - (*values_)[next_state])
+          (weight * ret - values_->Get(next_state))
               / cumulative_sums_[next_state];
     } else if (importance_sampling_ == ImportanceSampling::kWeighted) {
       cumulative_sums_[next_state] += weight;
       (*values_)[next_state] +=
-          weight * (ret - (*values_)[next_state])
+          weight * (ret - values_->Get(next_state))
               / cumulative_sums_[next_state];
     }
-    std::vector<Action> legal_actions = state.LegalActions();
-    int num_legal_actions = legal_actions.size();
-    Action target_policy_greedy_action =
-        *std::max_element(legal_actions.begin(), legal_actions.end(),
-                          [&](const Action &a1, const Action &a2) {
-                            return (*values_)[state.Child(a1)]
-                                < (*values_)[state.Child(a2)];
-                          });
+    int num_legal_actions = state.NumLegalActions();
+    int num_target_policy_greedy_actions;
     double target_policy_greedy_value =
-        (*values_)[state.Child(target_policy_greedy_action)];
-    if ((*values_)[next_state] != target_policy_greedy_value) break;
-    int num_target_policy_greedy_actions =
-        std::count_if(legal_actions.begin(), legal_actions.end(),
-                      [&](const Action &action) {
-                        return (*values_)[state.Child(action)] ==
-                            target_policy_greedy_value;
-                      });
-    double behavior_policy_value = (*behavior_policy_values)[next_state];
-    Action behavior_policy_greedy_action =
-        *std::max_element(legal_actions.begin(), legal_actions.end(),
-                          [&](const Action &a1, const Action &a2) {
-                            return (*behavior_policy_values)[state.Child(a1)] <
-                                (*behavior_policy_values)[state.Child(a2)];
-                          });
+        GreedyValue(state, &num_target_policy_greedy_actions);
+    if (values_->Get(next_state) != target_policy_greedy_value) break;
+    double behavior_policy_value = behavior_policy_value_of(next_state);
+    int num_behavior_policy_greedy_actions;
     double behavior_policy_greedy_value =
-        (*behavior_policy_values)[state.Child(behavior_policy_greedy_action)];
-    int num_behavior_policy_greedy_actions =
-        std::count_if(legal_actions.begin(), legal_actions.end(),
-                      [&](const Action &action) {
-                        return (*behavior_policy_values)[state.Child(action)] ==
-                            behavior_policy_greedy_value;
-                      });
+        GreedyValue(state, behavior_policy_value_of,
+                    &num_behavior_policy_greedy_actions);
     if (behavior_policy_value == behavior_policy_greedy_value) {
       weight *= ((1 - epsilon) / num_target_policy_greedy_actions
           + epsilon / num_legal_actions)
@@ -37,22 +37,36 @@ class MonteCarloAgent : public RLAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new MonteCarloAgent(*this));
   }
+  std::string GetType() const override { return "MonteCarloAgent"; }
   double GetGamma() const { return gamma_; }
+  Hyperparameters GetHyperparameters() const override {
+    return {{"gamma", gamma_}};
+  }
   void Initialize(const std::vector<State> &) override;
   Action PolicyImpl(const std::vector<Action> &/*legal_actions*/,
                     const std::vector<Action> &greedy_actions) override {
     return SampleAction(greedy_actions);
   }
+  void PolicyImplProbs(const std::vector<Action> &/*legal_actions*/,
+                       const std::vector<Action> &greedy_actions,
+                       ActionProbs *probs) const override {
+    AddUniformProbs(greedy_actions, 1.0, probs);
+  }
   void Reset() override;
   void SetGamma(double gamma) { gamma_ = gamma; }
+  void SetHyperparameters(const Hyperparameters &hyperparameters) override {
+    gamma_ = hyperparameters.at("gamma");
+  }
   Action Step(Game *, bool is_evaluation) override;
   void Update(const State &update_state, const State &current_state,
               Reward reward) override;
+  void UpdateEpisode(const std::vector<TimeStep> &time_steps) override;
 
  protected:
   double gamma_;
-  std::vector<TimeStep> trajectory_;
+  Trajectory trajectory_;
   std::unordered_map<State, double> cumulative_sums_;
+  void BindArena(Arena *arena) override;
 };
 
 class ESMonteCarloAgent : public MonteCarloAgent {
@@ -67,6 +81,7 @@ class ESMonteCarloAgent : public MonteCarloAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new ESMonteCarloAgent(*this));
   }
+  std::string GetType() const override { return "ESMonteCarloAgent"; }
   Action Step(Game *, bool is_evaluation) override;
 };
 
@@ -84,10 +99,16 @@ class OnPolicyMonteCarloAgent : public MonteCarloAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new OnPolicyMonteCarloAgent(*this));
   }
+  std::string GetType() const override { return "OnPolicyMonteCarloAgent"; }
   Action PolicyImpl(const std::vector<Action> &legal_actions,
                     const std::vector<Action> &greedy_actions) override {
     return exploration_->Explore(legal_actions, greedy_actions);
   }
+  void PolicyImplProbs(const std::vector<Action> &legal_actions,
+                       const std::vector<Action> &greedy_actions,
+                       ActionProbs *probs) const override {
+    exploration_->GetActionProbs(legal_actions, greedy_actions, probs);
+  }
   void UpdateExploration(int episode) override {
     exploration_->Update(episode);
   }
@@ -116,10 +137,18 @@ class OffPolicyMonteCarloAgent : public MonteCarloAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new OffPolicyMonteCarloAgent(*this));
   }
+  Hyperparameters GetHyperparameters() const override;
+  std::string GetType() const override { return "OffPolicyMonteCarloAgent"; }
   Action PolicyImpl(const std::vector<Action> &legal_actions,
                     const std::vector<Action> &greedy_actions) override {
     return epsilon_greedy_.Explore(legal_actions, greedy_actions);
   }
+  void PolicyImplProbs(const std::vector<Action> &legal_actions,
+                       const std::vector<Action> &greedy_actions,
+                       ActionProbs *probs) const override {
+    epsilon_greedy_.GetActionProbs(legal_actions, greedy_actions, probs);
+  }
+  void SetHyperparameters(const Hyperparameters &) override;
   void Update(const State &update_state, const State &current_state,
               Reward reward) override;
   void UpdateExploration(int episode) override {
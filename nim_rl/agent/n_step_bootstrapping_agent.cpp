@@ -17,6 +17,18 @@
 
 namespace nim_rl {
 
+void NStepBootstrappingAgent::BindArena(Arena *arena) {
+  TDAgent::BindArena(arena);
+  trajectory_ = Trajectory(ArenaAllocator<TimeStep>(arena));
+}
+
+RLAgent::Hyperparameters
+NStepBootstrappingAgent::GetHyperparameters() const {
+  Hyperparameters hyperparameters = TDAgent::GetHyperparameters();
+  hyperparameters["n"] = n_;
+  return hyperparameters;
+}
+
 void NStepBootstrappingAgent::Reset() {
   TDAgent::Reset();
   current_time_ = 0;
@@ -25,40 +37,56 @@ void NStepBootstrappingAgent::Reset() {
   trajectory_.clear();
 }
 
+void NStepBootstrappingAgent::SetHyperparameters(
+    const Hyperparameters &hyperparameters) {
+  TDAgent::SetHyperparameters(hyperparameters);
+  n_ = static_cast<int>(hyperparameters.at("n"));
+}
+
 Action NStepBootstrappingAgent::Step(Game *game, bool is_evaluation) {
   Action action;
   if (!trajectory_.empty())
     std::get<2>(trajectory_.back()) = -game->GetReward();
-  State state = game->GetState();
+  const State &state = game->GetState();
   if (state.IsTerminal()) std::get<2>(trajectory_.back()) = 0.0;
-  action = Policy(state, is_evaluation);
-  game->Step(action);
-  trajectory_.emplace_back(state, action, game->GetReward());
-  if (game->GetState().IsTerminal() || game->GetState().IsEmpty())
-    terminal_time_ = current_time_ + 1;
+  {
+    NIM_RL_TIME(policy_seconds);
+    action = Policy(state, is_evaluation);
+  }
+  // Recorded before the game moves on from the state, which is read in place.
+  trajectory_.emplace_back(state, action, 0.0);
+  const State &next_state = game->Step(action);
+  std::get<2>(trajectory_.back()) = game->GetReward();
+  bool is_over = next_state.IsTerminal() || next_state.IsEmpty();
+  if (is_over) terminal_time_ = current_time_ + 1;
   if (!is_evaluation) {
+    NIM_RL_TIME(update_seconds);
     update_time_ = current_time_ - n_;
     if (update_time_ >= 0) {
-      TimeStep time_step = trajectory_[update_time_];
+      const TimeStep &time_step = trajectory_[update_time_];
       State update_state =
           std::get<0>(time_step).Child(std::get<1>(time_step));
-      Update(update_state, game->GetState(), 0.0);
-    }
-    if (game->GetState().IsTerminal() || game->GetState().IsEmpty()) {
-      while (++update_time_ < terminal_time_ - 1) {
-        if (update_time_ >= 0) {
-          TimeStep time_step = trajectory_[update_time_];
-          State update_state =
-              std::get<0>(time_step).Child(std::get<1>(time_step));
-          Update(update_state, game->GetState(), 0.0);
-        }
-      }
+      NIM_RL_COUNT(updates);
+      Update(update_state, next_state, 0.0);
     }
+    if (is_over) FlushUpdates(next_state);
   }
   ++current_time_;
   return action;
 }
 
+void NStepBootstrappingAgent::FlushUpdates(const State &current_state) {
+  while (++update_time_ < terminal_time_ - 1) {
+    if (update_time_ >= 0) {
+      const TimeStep &time_step = trajectory_[update_time_];
+      State update_state =
+          std::get<0>(time_step).Child(std::get<1>(time_step));
+      NIM_RL_COUNT(updates);
+      Update(update_state, current_state, 0.0);
+    }
+  }
+}
+
 void NStepSarsaAgent::Update(const State &update_state,
                              const State &current_state,
                              Reward /*reward*/) {
@@ -67,15 +95,20 @@ void NStepSarsaAgent::Update(const State &update_state,
        i < std::min(update_time_ + n_ + 1, terminal_time_); ++i)
     ret += pow(gamma_, i - update_time_) * std::get<2>(trajectory_[i]);
   if (update_time_ + n_ < terminal_time_ - 1)
-    ret += pow(gamma_, n_) * (*values_)[current_state];
-  (*values_)[update_state] += alpha_ * (ret - (*values_)[update_state]);
+    ret += pow(gamma_, n_) * values_->Get(current_state);
+  (*values_)[update_state] += alpha_ * (ret - values_->Get(update_state));
 }
 
 Action NStepExpectedSarsaAgent::Policy(const State &state, bool is_evaluation) {
-  SetNextStates(state.Children());
+  state.Children(&next_states_);
   return NStepBootstrappingAgent::Policy(state, is_evaluation);
 }
 
+void NStepExpectedSarsaAgent::BindArena(Arena *arena) {
+  NStepBootstrappingAgent::BindArena(arena);
+  next_states_ = ArenaVector<State>(ArenaAllocator<State>(arena));
+}
+
 void NStepExpectedSarsaAgent::Reset() {
   NStepBootstrappingAgent::Reset();
   next_states_.clear();
@@ -94,15 +127,15 @@ void NStepExpectedSarsaAgent::Update(const State &update_state,
     if (!legal_actions_.empty()) {
       double epsilon = epsilon_greedy_.GetEpsilon();
       for (const auto &state : next_states_)
-        if ((*values_)[state] != greedy_value_)
-          expectation += epsilon * (*values_)[state] / legal_actions_.size();
+        if (values_->Get(state) != greedy_value_)
+          expectation += epsilon * values_->Get(state) / legal_actions_.size();
       expectation += (1 - epsilon) * greedy_value_
           + greedy_actions_.size() * epsilon * greedy_value_
               / legal_actions_.size();
     }
     ret += pow(gamma_, n_) * expectation;
   }
-  (*values_)[update_state] += alpha_ * (ret - (*values_)[update_state]);
+  (*values_)[update_state] += alpha_ * (ret - values_->Get(update_state));
 }
 
 void OffPolicyNStepSarsaAgent::Update(const State &update_state,
@@ -116,26 +149,14 @@ void OffPolicyNStepSarsaAgent::Update(const State &update_state,
     if (!state.IsTerminal()) {
       const Action &action = std::get<1>(trajectory_[i]);
       const State &next_state = state.Child(action);
-      double value = (*values_)[next_state];
-      std::vector<Action> legal_actions = state.LegalActions();
-      Action greedy_action =
-          *std::max_element(legal_actions.begin(), legal_actions.end(),
-                            [&](const Action &a1, const Action &a2) {
-                              return (*values_)[state.Child(a1)] <
-                                  (*values_)[state.Child(a2)];
-                            });
-      double greedy_value = (*values_)[state.Child(greedy_action)];
+      double value = values_->Get(next_state);
+      int num_greedy_actions;
+      double greedy_value = GreedyValue(state, &num_greedy_actions);
       if (value != greedy_value) {
         weight = 0.0;
         break;
       } else {
-        int num_legal_actions = legal_actions.size();
-        int num_greedy_actions =
-            std::count_if(legal_actions.begin(), legal_actions.end(),
-                          [&](const Action &action) {
-                            return (*values_)[state.Child(action)] ==
-                                greedy_value;
-                          });
+        int num_legal_actions = state.NumLegalActions();
         weight *= num_legal_actions / ((1 - epsilon) * num_legal_actions
             + epsilon * num_greedy_actions);
       }
@@ -146,18 +167,23 @@ void OffPolicyNStepSarsaAgent::Update(const State &update_state,
     ret += pow(gamma_, i - update_time_) * std::get<2>(trajectory_[i]);
   }
   if (update_time_ + n_ < terminal_time_ - 1) {
-    ret += pow(gamma_, n_) * (*values_)[current_state];
+    ret += pow(gamma_, n_) * values_->Get(current_state);
   }
   (*values_)[update_state] +=
-      alpha_ * (weight * ret - (*values_)[update_state]);
+      alpha_ * (weight * ret - values_->Get(update_state));
 }
 
 Action OffPolicyNStepExpectedSarsaAgent::Policy(const State &state,
                                                 bool is_evaluation) {
-  SetNextStates(state.Children());
+  state.Children(&next_states_);
   return NStepBootstrappingAgent::Policy(state, is_evaluation);
 }
 
+void OffPolicyNStepExpectedSarsaAgent::BindArena(Arena *arena) {
+  NStepBootstrappingAgent::BindArena(arena);
+  next_states_ = ArenaVector<State>(ArenaAllocator<State>(arena));
+}
+
 void OffPolicyNStepExpectedSarsaAgent::Reset() {
   NStepBootstrappingAgent::Reset();
   next_states_.clear();
@@ -174,26 +200,14 @@ void OffPolicyNStepExpectedSarsaAgent::Update(const State &update_state,
     if (!state.IsTerminal()) {
       const Action &action = std::get<1>(trajectory_[i]);
       const State &next_state = state.Child(action);
-      double value = (*values_)[next_state];
-      std::vector<Action> legal_actions = state.LegalActions();
-      Action greedy_action =
-          *std::max_element(legal_actions.begin(), legal_actions.end(),
-                            [&](const Action &a1, const Action &a2) {
-                              return (*values_)[state.Child(a1)] <
-                                  (*values_)[state.Child(a2)];
-                            });
-      double greedy_value = (*values_)[state.Child(greedy_action)];
+      double value = values_->Get(next_state);
+      int num_greedy_actions;
+      double greedy_value = GreedyValue(state, &num_greedy_actions);
       if (value != greedy_value) {
         weight = 0.0;
         break;
       } else {
-        int num_legal_actions = legal_actions.size();
-        int num_greedy_actions =
-            std::count_if(legal_actions.begin(), legal_actions.end(),
-                          [&](const Action &action) {
-                            return (*values_)[state.Child(action)] ==
-                                greedy_value;
-                          });
+        int num_legal_actions = state.NumLegalActions();
         weight *= num_legal_actions / ((1 - epsilon) * num_legal_actions
             + epsilon * num_greedy_actions);
       }
@@ -206,8 +220,8 @@ void OffPolicyNStepExpectedSarsaAgent::Update(const State &update_state,
     double expectation = 0.0;
     if (!legal_actions_.empty()) {
       for (const auto &state : next_states_)
-        if ((*values_)[state] != greedy_value_)
-          expectation += epsilon * (*values_)[state] / legal_actions_.size();
+        if (values_->Get(state) != greedy_value_)
+          expectation += epsilon * values_->Get(state) / legal_actions_.size();
       expectation += (1 - epsilon) * greedy_value_
           + greedy_actions_.size() * epsilon * greedy_value_
               / legal_actions_.size();
@@ -215,58 +229,75 @@ void OffPolicyNStepExpectedSarsaAgent::Update(const State &update_state,
     ret += pow(gamma_, n_) * expectation;
   }
   (*values_)[update_state] +=
-      alpha_ * (weight * ret - (*values_)[update_state]);
+      alpha_ * (weight * ret - values_->Get(update_state));
 }
 
 void NStepTreeBackupAgent::Update(const State &update_state,
                                   const State &/*current_state*/,
                                   Reward /*reward*/) {
   int backup_time = std::min(update_time_ + n_, terminal_time_ - 1);
-  double ret = std::get<2>(trajectory_[backup_time]);
-  State backup_state = std::get<0>(trajectory_[backup_time]);
-  if (!backup_state.IsTerminal()) {
-    std::vector<Action> legal_actions = backup_state.LegalActions();
-    Action greedy_action =
-        *std::max_element(legal_actions.begin(), legal_actions.end(),
-                          [&](const Action &a1, const Action &a2) {
-                            return (*values_)[backup_state.Child(a1)] <
-                                (*values_)[backup_state.Child(a2)];
-                          });
-    Reward greedy_value = (*values_)[backup_state.Child(greedy_action)];
-    ret = gamma_ * greedy_value;
-  }
+  Reward ret = BackupTarget(backup_time);
   for (int i = backup_time - 1; i > update_time_; --i) {
-    State state_i = std::get<0>(trajectory_[i]);
-    Action action_i = std::get<1>(trajectory_[i]);
-    Reward reward_i = std::get<2>(trajectory_[i]);
-    std::vector<Action> legal_actions = state_i.LegalActions();
-    Action greedy_action =
-        *std::max_element(legal_actions.begin(), legal_actions.end(),
-                          [&](const Action &a1, const Action &a2) {
-                            return (*values_)[state_i.Child(a1)] <
-                                (*values_)[state_i.Child(a2)];
-                          });
-    Reward greedy_value = (*values_)[state_i.Child(greedy_action)];
-    int num_greedy_actions =
-        std::count_if(legal_actions.begin(), legal_actions.end(),
-                      [&](const Action &action) {
-                        return (*values_)[state_i.Child(action)] ==
-                            greedy_value;
-                      });
-    double expectation = 0.0;
-    std::vector<State> next_states = state_i.Children();
-    for (const auto &state : next_states) {
-      if (state_i.Child(action_i) != state) {
-        if ((*values_)[state] == greedy_value)
-          expectation += (*values_)[state] / num_greedy_actions;
-      } else {
-        if ((*values_)[state] == greedy_value)
-          expectation += ret / num_greedy_actions;
-      }
+    GreedySummary summary = Summarize(i);
+    ret = std::get<2>(trajectory_[i])
+        + gamma_ * (summary.base + summary.weight * ret);
+  }
+  (*values_)[update_state] += alpha_ * (ret - values_->Get(update_state));
+}
+
+void NStepTreeBackupAgent::FlushUpdates(const State &/*current_state*/) {
+  // All pending updates back up to the last time step, so their returns are
+  // the suffixes of a single backward pass over the trajectory. Updating an
+  // after-state never changes the children of later states in the episode.
+  int first_update_time = std::max(update_time_ + 1, 0);
+  int backup_time = terminal_time_ - 1;
+  if (first_update_time < backup_time) {
+    returns_.resize(backup_time - first_update_time);
+    Reward ret = BackupTarget(backup_time);
+    returns_.back() = ret;
+    for (int i = backup_time - 1; i > first_update_time; --i) {
+      GreedySummary summary = Summarize(i);
+      ret = std::get<2>(trajectory_[i])
+          + gamma_ * (summary.base + summary.weight * ret);
+      returns_[i - 1 - first_update_time] = ret;
+    }
+    for (int i = first_update_time; i < backup_time; ++i) {
+      const TimeStep &time_step = trajectory_[i];
+      State update_state =
+          std::get<0>(time_step).Child(std::get<1>(time_step));
+      Value *value = &(*values_)[update_state];
+      *value += alpha_ * (returns_[i - first_update_time] - *value);
+      NIM_RL_COUNT(updates);
     }
-    ret = reward_i + gamma_ * expectation;
   }
-  (*values_)[update_state] += alpha_ * (ret - (*values_)[update_state]);
+  update_time_ = std::max(update_time_ + 1, backup_time);
+}
+
+Agent::Reward NStepTreeBackupAgent::BackupTarget(int backup_time) {
+  const State &backup_state = std::get<0>(trajectory_[backup_time]);
+  if (backup_state.IsTerminal()) return std::get<2>(trajectory_[backup_time]);
+  int num_greedy_actions;
+  return gamma_ * GreedyValue(backup_state, &num_greedy_actions);
+}
+
+NStepTreeBackupAgent::GreedySummary
+NStepTreeBackupAgent::Summarize(int time_step) {
+  const State &state = std::get<0>(trajectory_[time_step]);
+  const Action &action = std::get<1>(trajectory_[time_step]);
+  int num_greedy_actions;
+  Reward greedy_value = GreedyValue(state, &num_greedy_actions);
+  if (values_->Get(state.Child(action)) != greedy_value)
+    return {greedy_value, 0.0};
+  // Taking as many objects from any pile of the same size leads to the same
+  // canonical child as the taken action, and no other action does, so
+  // exactly those actions share the backed-up return.
+  unsigned taken_pile = state[action.GetPileId()];
+  int num_taken_actions = 0;
+  for (int pile_id = 0; pile_id != state.Size(); ++pile_id)
+    if (state[pile_id] == taken_pile) ++num_taken_actions;
+  return {greedy_value * (num_greedy_actions - num_taken_actions)
+              / num_greedy_actions,
+          static_cast<double>(num_taken_actions) / num_greedy_actions};
 }
 
 }  // namespace nim_rl
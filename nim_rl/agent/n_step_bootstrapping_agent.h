@@ -40,8 +40,11 @@ class NStepBootstrappingAgent : public TDAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new NStepBootstrappingAgent(*this));
   }
+  std::string GetType() const override { return "NStepBootstrappingAgent"; }
+  Hyperparameters GetHyperparameters() const override;
   int GetN() const { return n_; }
   void Reset() override;
+  void SetHyperparameters(const Hyperparameters &) override;
   void SetN(int n) { n_ = n; }
   Action Step(Game *, bool is_evaluation) override;
 
@@ -50,7 +53,9 @@ class NStepBootstrappingAgent : public TDAgent {
   int current_time_ = 0;
   int terminal_time_ = INT_MAX;
   int update_time_ = 0;
-  std::vector<TimeStep> trajectory_;
+  Trajectory trajectory_;
+  void BindArena(Arena *arena) override;
+  virtual void FlushUpdates(const State &current_state);
 };
 
 class NStepSarsaAgent : public NStepBootstrappingAgent {
@@ -72,6 +77,7 @@ class NStepSarsaAgent : public NStepBootstrappingAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new NStepSarsaAgent(*this));
   }
+  std::string GetType() const override { return "NStepSarsaAgent"; }
   void Update(const State &update_state, const State &current_state,
               Reward reward) override;
 };
@@ -95,16 +101,20 @@ class NStepExpectedSarsaAgent : public NStepBootstrappingAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new NStepExpectedSarsaAgent(*this));
   }
+  std::string GetType() const override { return "NStepExpectedSarsaAgent"; }
   Action Policy(const State &, bool is_evaluation) override;
   void Reset() override;
   void Update(const State &update_state, const State &current_state,
               Reward reward) override;
 
+ protected:
+  void BindArena(Arena *arena) override;
+
  private:
-  std::vector<State> next_states_;
-  template<typename T>
-  void SetNextStates(T &&next_states) {
-    next_states_ = std::forward<T>(next_states);
+  ArenaVector<State> next_states_;
+  void SetNextStates(std::vector<State> next_states) {
+    next_states_.assign(std::make_move_iterator(next_states.begin()),
+                        std::make_move_iterator(next_states.end()));
   }
 };
 
@@ -128,6 +138,7 @@ class OffPolicyNStepSarsaAgent : public NStepBootstrappingAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new OffPolicyNStepSarsaAgent(*this));
   }
+  std::string GetType() const override { return "OffPolicyNStepSarsaAgent"; }
   void Update(const State &update_state, const State &current_state,
               Reward reward) override;
 };
@@ -155,16 +166,22 @@ class OffPolicyNStepExpectedSarsaAgent : public NStepBootstrappingAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new OffPolicyNStepExpectedSarsaAgent(*this));
   }
+  std::string GetType() const override {
+    return "OffPolicyNStepExpectedSarsaAgent";
+  }
   Action Policy(const State &, bool is_evaluation) override;
   void Reset() override;
   void Update(const State &update_state, const State &current_state,
               Reward reward) override;
 
+ protected:
+  void BindArena(Arena *arena) override;
+
  private:
-  std::vector<State> next_states_;
-  template<typename T>
-  void SetNextStates(T &&next_states) {
-    next_states_ = std::forward<T>(next_states);
+  ArenaVector<State> next_states_;
+  void SetNextStates(std::vector<State> next_states) {
+    next_states_.assign(std::make_move_iterator(next_states.begin()),
+                        std::make_move_iterator(next_states.end()));
   }
 };
 
@@ -187,8 +204,24 @@ class NStepTreeBackupAgent : public NStepBootstrappingAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new NStepTreeBackupAgent(*this));
   }
+  std::string GetType() const override { return "NStepTreeBackupAgent"; }
   void Update(const State &update_state, const State &current_state,
               Reward reward) override;
+
+ protected:
+  void FlushUpdates(const State &current_state) override;
+
+ private:
+  // Expectation of the greedy target policy at a time step as an affine
+  // function base + weight * ret of the return through the taken action.
+  struct GreedySummary {
+    Reward base;
+    double weight;
+  };
+  // The returns of the pending updates, kept to reuse its storage.
+  std::vector<Reward> returns_;
+  Reward BackupTarget(int backup_time);
+  GreedySummary Summarize(int time_step);
 };
 
 }  // namespace nim_rl
@@ -16,6 +16,18 @@
 
 namespace nim_rl {
 
+void OptimalAgent::GetActionProbs(const State &state, bool is_evaluation,
+                                  ActionProbs *probs) {
+  probs->clear();
+  if (state.NimSum()) {
+    probs->emplace_back(Policy(state, is_evaluation), 1.0);
+  } else {
+    std::vector<Action> legal_actions;
+    state.LegalActions(&legal_actions);
+    AddUniformProbs(legal_actions, 1.0, probs);
+  }
+}
+
 Action OptimalAgent::Policy(const State &state, bool /*is_evaluation*/) {
   unsigned nim_sum = state.NimSum();
   for (int pile_id = 0; pile_id != state.Size(); ++pile_id) {
@@ -24,7 +36,28 @@ Action OptimalAgent::Policy(const State &state, bool /*is_evaluation*/) {
       return Action{pile_id,
                     static_cast<int>(state[pile_id] - num_objects_target)};
   }
-  return SampleAction(state.LegalActions());
+  return SampleAction(state);
+}
+
+// Same choice as Policy above for every state in the batch, with the nim sums
+// computed by the batch kernels.
+void OptimalAgent::Policy(const StateBatch &states,
+                          std::vector<Action> *actions) {
+  std::vector<unsigned> nim_sums;
+  states.NimSum(&nim_sums);
+  actions->assign(states.Size(), Action{});
+  for (int pile_id = 0; pile_id != states.NumPiles(); ++pile_id) {
+    const unsigned *pile = states.Pile(pile_id);
+    for (StateBatch::size_type i = 0; i != states.Size(); ++i) {
+      Action *action = &(*actions)[i];
+      unsigned num_objects_target = pile[i] ^ nim_sums[i];
+      if (action->GetPileId() < 0 && num_objects_target < pile[i])
+        *action = Action{pile_id,
+                         static_cast<int>(pile[i] - num_objects_target)};
+    }
+  }
+  for (StateBatch::size_type i = 0; i != states.Size(); ++i)
+    if (!nim_sums[i]) (*actions)[i] = SampleAction(states.Get(i));
 }
 
 }  // namespace nim_rl
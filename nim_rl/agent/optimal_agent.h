@@ -16,6 +16,7 @@
 #define NIM_RL_AGENT_OPTIMAL_AGENT_H_
 
 #include "nim_rl/agent/agent.h"
+#include "nim_rl/state/state_batch.h"
 
 namespace nim_rl {
 
@@ -30,7 +31,11 @@ class OptimalAgent : public Agent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new OptimalAgent(*this));
   }
+  void GetActionProbs(const State &, bool is_evaluation,
+                      ActionProbs *probs) override;
   Action Policy(const State &, bool is_evaluation) override;
+  bool RequiresAllStates() const override { return false; }
+  void Policy(const StateBatch &, std::vector<Action> *actions);
 };
 
 }  // namespace nim_rl
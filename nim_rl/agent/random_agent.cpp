@@ -16,8 +16,16 @@
 
 namespace nim_rl {
 
+void RandomAgent::GetActionProbs(const State &state, bool /*is_evaluation*/,
+                                 ActionProbs *probs) {
+  std::vector<Action> legal_actions;
+  state.LegalActions(&legal_actions);
+  probs->clear();
+  AddUniformProbs(legal_actions, 1.0, probs);
+}
+
 Action RandomAgent::Policy(const State &state, bool /*is_evaluation*/) {
-  return SampleAction(state.LegalActions());
+  return SampleAction(state);
 }
 
 }  // namespace nim_rl
@@ -30,7 +30,10 @@ class RandomAgent : public Agent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new RandomAgent(*this));
   }
+  void GetActionProbs(const State &, bool is_evaluation,
+                      ActionProbs *probs) override;
   Action Policy(const State &, bool is_evaluation) override;
+  bool RequiresAllStates() const override { return false; }
 };
 
 }  // namespace nim_rl
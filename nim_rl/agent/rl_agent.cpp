@@ -13,11 +13,21 @@
 // limitations under the License.
 
 #include "nim_rl/agent/rl_agent.h"
+
+#include <stdexcept>
+
 #include "nim_rl/environment/game.h"
+#include "nim_rl/stats/tracer.h"
 
 namespace nim_rl {
 
 void RLAgent::Initialize(const std::vector<State> &all_states) {
+  // A mapped table is kept, so that training resumes where it stopped.
+  if (values_->IsMapped()) return;
+  if (values_->IsLazy() || values_->IsDense()) {
+    values_->Clear();
+    return;
+  }
   for (const auto &state : all_states) {
     if (state.IsTerminal()) {
       (*values_)[state] = kWinReward;
@@ -28,63 +38,97 @@ void RLAgent::Initialize(const std::vector<State> &all_states) {
   (*values_)[State()] = kTieReward;
 }
 
+void RLAgent::Load(const std::string &path) { Read(AgentFile(path)); }
+
 double RLAgent::MinSquareError() {
+  NIM_RL_TRACE("MinSquareError");
   int cnt = 0;
   double error = 0.0;
-  Values values = GetValues();
-  for (const auto &kv : values) {
-    if (kv.first.IsEmpty()) continue;
+  auto add_error = [&](const State &state, Reward value) {
+    if (state.IsEmpty()) return;
     ++cnt;
-    if (kv.first.NimSum()) {
-      error += (kv.second - kLoseReward) * (kv.second - kLoseReward);
-    } else {
-      error += (kv.second - kWinReward) * (kv.second - kWinReward);
-    }
+    Reward target = state.NimSum() ? kLoseReward : kWinReward;
+    error += (value - target) * (value - target);
+  };
+  // A dense table may not fit in memory, so it is streamed state by state.
+  if (values_->IsDense()) {
+    for (const auto &state : values_->GetStateRange())
+      add_error(state, GetValue(state));
+  } else {
+    for (const auto &kv : GetValues()) add_error(kv.first, kv.second);
   }
   return error / cnt;
 }
 
 double RLAgent::OptimalActionsRatio() {
+  NIM_RL_TRACE("OptimalActionsRatio");
   double num_n_positions = 0.0;
   double num_optimal_actions = 0.0;
-  Values values = GetValues();
-  std::cout << values << std::endl;
-  for (const auto &kv : values) {
-    if (kv.first.NimSum()) {
-      ++num_n_positions;
-      std::vector<Action> legal_actions = kv.first.LegalActions();
-      Action greedy_action =
-          *std::max_element(legal_actions.begin(), legal_actions.end(),
-                            [&](const Action &a1, const Action &a2) {
-                              return values[kv.first.Child(a1)]
-                                  < values[kv.first.Child(a2)];
-                            });
-      if (!kv.first.Child(greedy_action).NimSum())
-        ++num_optimal_actions;
+  auto count_optimal = [&](const State &state, auto value_of) {
+    if (!state.NimSum()) return;
+    ++num_n_positions;
+    bool is_first_child = true, is_optimal = false;
+    Reward greedy_value = 0.0;
+    for (const auto &child : state.ChildrenView()) {
+      Reward value = value_of(child);
+      if (is_first_child || value > greedy_value) {
+        greedy_value = value;
+        is_optimal = !child.NimSum();
+        is_first_child = false;
+      }
     }
+    if (is_optimal) ++num_optimal_actions;
+  };
+  if (values_->IsDense()) {
+    auto value_of = [this](const State &child) { return GetValue(child); };
+    for (const auto &state : values_->GetStateRange())
+      count_optimal(state, value_of);
+  } else {
+    Values values = GetValues();
+    auto value_of = [&values](const State &child) {
+      auto iter = values.find(child);
+      return iter != values.end() ? iter->second
+                                  : ValueTable::InitialValue(child);
+    };
+    for (const auto &kv : values) count_optimal(kv.first, value_of);
   }
   return num_optimal_actions / num_n_positions;
 }
 
+void RLAgent::Read(const AgentFile &file) {
+  std::vector<ValueTable *> tables = GetValueTables();
+  if (file.GetAgentType() != GetType() || file.NumTables() != tables.size())
+    throw std::runtime_error("Cannot load a " + file.GetAgentType()
+                                 + " into a " + GetType() + ".");
+  SetHyperparameters(file.GetHyperparameters());
+  for (int table = 0; table != tables.size(); ++table)
+    file.ReadTable(table, tables[table]);
+}
+
+void RLAgent::GetActionProbs(const State &state, bool is_evaluation,
+                             ActionProbs *probs) {
+  probs->clear();
+  std::vector<Action> legal_actions, greedy_actions;
+  state.LegalActions(&legal_actions);
+  if (legal_actions.empty()) return;
+  int num_greedy_actions;
+  GreedyValue(state, [this](const State &child) { return GetValue(child); },
+              &num_greedy_actions, &greedy_actions);
+  if (is_evaluation)
+    AddUniformProbs(greedy_actions, 1.0, probs);
+  else
+    PolicyImplProbs(legal_actions, greedy_actions, probs);
+}
+
 Action RLAgent::Policy(const State &state, bool is_evaluation) {
-  legal_actions_ = state.LegalActions();
+  state.LegalActions(&legal_actions_);
   greedy_actions_.clear();
   if (legal_actions_.empty()) {
     greedy_value_ = 0.0;
     return Action{};
   } else {
-    Action greedy_action =
-        *std::max_element(legal_actions_.begin(), legal_actions_.end(),
-                          [&](const Action &a1, const Action &a2) {
-                            return (*values_)[state.Child(a1)]
-                                < (*values_)[state.Child(a2)];
-                          });
-    greedy_value_ = (*values_)[state.Child(greedy_action)];
-    std::copy_if(legal_actions_.begin(), legal_actions_.end(),
-                 std::back_inserter(greedy_actions_),
-                 [&](const Action &action) {
-                   return (*values_)[state.Child(action)] == greedy_value_;
-                 });
+    int num_greedy_actions;
+    greedy_value_ = GreedyValue(state, &num_greedy_actions, &greedy_actions_);
     if (is_evaluation) {
       return SampleAction(greedy_actions_);
     } else {
@@ -93,6 +137,13 @@ Action RLAgent::Policy(const State &state, bool is_evaluation) {
   }
 }
 
+void RLAgent::PolicyImplProbs(const std::vector<Action> &,
+                              const std::vector<Action> &,
+                              ActionProbs *) const {
+  throw std::logic_error(GetType() + " does not expose its action "
+                         "probabilities.");
+}
+
 void RLAgent::Reset() {
   Agent::Reset();
   greedy_value_ = 0.0;
@@ -100,6 +151,13 @@ void RLAgent::Reset() {
   greedy_actions_.clear();
 }
 
+void RLAgent::Save(const std::string &path, const State &initial_state,
+                   AgentFile::ValueType value_type) const {
+  std::vector<ValueTable *> tables = GetValueTables();
+  AgentFile::Write(path, GetType(), initial_state, GetHyperparameters(),
+                   {tables.begin(), tables.end()}, GetPolicyMap(), value_type);
+}
+
 std::ostream &operator<<(std::ostream &os,
                          const std::unordered_map<State,
                                                   Agent::Reward> &values) {
@@ -110,11 +168,34 @@ std::ostream &operator<<(std::ostream &os,
 }
 
 std::ostream &operator<<(std::ostream &os,
-                         const std::vector<RLAgent::TimeStep> &trajectory) {
+                         const RLAgent::Trajectory &trajectory) {
   for (const auto &time_step : trajectory)
     os << std::get<0>(time_step) << ", " << std::get<1>(time_step) << ", "
        << std::get<2>(time_step) << "; ";
   return os;
 }
 
+void RLAgent::UpdateBatch(const Transition *, std::size_t) {
+  throw std::logic_error(GetType() + " does not support batch updates.");
+}
+
+void RLAgent::UpdateEpisode(const std::vector<TimeStep> &time_steps) {
+  auto afterstate_of = [](const TimeStep &time_step) {
+    const State &state = std::get<0>(time_step);
+    const Action &action = std::get<1>(time_step);
+    return action.IsLegal(state) ? state.Child(action) : State();
+  };
+  std::vector<Transition> transitions;
+  transitions.reserve(time_steps.size());
+  for (std::size_t step = 0; step + 1 < time_steps.size(); ++step) {
+    State afterstate = afterstate_of(time_steps[step]);
+    if (afterstate.IsTerminal()) continue;
+    transitions.push_back({std::get<2>(time_steps[step]),
+                           std::move(afterstate),
+                           std::get<0>(time_steps[step + 1]),
+                           afterstate_of(time_steps[step + 1])});
+  }
+  UpdateBatch(transitions.data(), transitions.size());
+}
+
 }  // namespace nim_rl
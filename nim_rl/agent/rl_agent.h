@@ -15,19 +15,36 @@
 #ifndef NIM_RL_AGENT_RL_AGENT_H_
 #define NIM_RL_AGENT_RL_AGENT_H_
 
+#include <cstddef>
+#include <string>
+
 #include "nim_rl/agent/agent.h"
+#include "nim_rl/agent/agent_file.h"
+#include "nim_rl/agent/value_table.h"
 
 namespace nim_rl {
 
 constexpr double kDefaultAlpha = 0.5;
 constexpr double kDefaultGamma = 1.0;
 
+// One step of experience, as TD agents see it: the afterstate the agent left,
+// the reward it received before its next move, the state it then faced and
+// the afterstate it chose from there. A terminal next_state ends the episode.
+struct Transition {
+  Agent::Reward reward;
+  State state;
+  State next_state;
+  State next_afterstate;
+};
+
 class RLAgent : public Agent {
  public:
   using StateAction = std::pair<State, Action>;
   using StateProb = std::pair<State, double>;
   using TimeStep = std::tuple<State, Action, Reward>;
-  using Values = std::unordered_map<State, Reward>;
+  using Trajectory = ArenaVector<TimeStep>;
+  using Values = ValueTable::Values;
+  using Hyperparameters = AgentFile::Hyperparameters;
   RLAgent() = default;
   RLAgent(const RLAgent &) = default;
   RLAgent(RLAgent &&) = default;
@@ -38,39 +55,140 @@ class RLAgent : public Agent {
     greedy_actions_.push_back(action);
   }
   void ClearGreedyActions() { greedy_actions_.clear(); }
+  // Uniform over the actions with the highest GetValue in evaluation, and
+  // PolicyImplProbs otherwise.
+  void GetActionProbs(const State &, bool is_evaluation,
+                      ActionProbs *probs) override;
   std::vector<Action> GetGreedyActions() { return greedy_actions_; }
   Reward GetGreedyValue() const { return greedy_value_; }
+  virtual Hyperparameters GetHyperparameters() const { return {}; }
   std::vector<Action> GetLegalActions() const { return legal_actions_; }
-  virtual Values GetValues() const { return *values_; }
+  virtual std::string GetType() const { return "RLAgent"; }
+  // Stores the values densely at the given precision, see
+  // ValueTable::Compact.
+  virtual void CompactValues(const State &initial_state, Precision precision,
+                             std::size_t cache_capacity
+                                 = kDefaultValueCacheCapacity) {
+    values_->Compact(initial_state, precision, cache_capacity);
+  }
+  virtual void FlushValues() { values_->Flush(); }
+  virtual Reward GetValue(const State &state) const {
+    return values_->Get(state);
+  }
+  virtual Values GetValues() const { return values_->GetValues(); }
   void Initialize(const std::vector<State> &) override;
+  bool IsDense() const { return values_->IsDense(); }
+  bool IsLazy() const { return values_->IsLazy(); }
+  bool IsMapped() const { return values_->IsMapped(); }
+  // Replaces the values and hyperparameters with those saved by an agent of
+  // the same type.
+  void Load(const std::string &path);
+  // Keeps the values in a file instead of memory, see ValueTable::Map.
+  virtual void MapValues(const std::string &path, const State &initial_state,
+                         Precision precision = Precision::kFloat64,
+                         std::size_t cache_capacity
+                             = kDefaultValueCacheCapacity) {
+    values_->Map(path, initial_state, precision, cache_capacity);
+  }
   double MinSquareError();
   double OptimalActionsRatio();
   Action Policy(const State &, bool is_evaluation) override;
   virtual Action PolicyImpl(const std::vector<Action> &legal_actions,
                             const std::vector<Action> &greedy_actions) = 0;
+  // Adds the distribution PolicyImpl draws from to probs. Throws
+  // std::logic_error unless the agent overrides it.
+  virtual void PolicyImplProbs(const std::vector<Action> &legal_actions,
+                               const std::vector<Action> &greedy_actions,
+                               ActionProbs *probs) const;
+  bool RequiresAllStates() const override {
+    return !values_->IsLazy() && !values_->IsDense();
+  }
   void Reset() override;
+  // Saves the values of the states reachable from initial_state.
+  void Save(const std::string &path, const State &initial_state,
+            AgentFile::ValueType value_type
+                = AgentFile::ValueType::kFloat64) const;
   void SetGreedyActions(const std::vector<Action> &greedy_actions) {
     greedy_actions_ = greedy_actions;
   }
   void SetGreedyValue(Reward greedy_value) { greedy_value_ = greedy_value; }
+  virtual void SetHyperparameters(const Hyperparameters &) {}
   void SetLegalActions(const std::vector<Action> &legal_actions) {
     legal_actions_ = legal_actions;
   }
-  virtual void SetValues(const Values &values) { *values_ = values; }
+  virtual void SetLazy(bool is_lazy) { values_->SetLazy(is_lazy); }
+  virtual void SetValues(const Values &values) { values_->SetValues(values); }
+  // Learns from transitions collected elsewhere, e.g. replayed or offline
+  // experience, without playing. Agents that cannot learn from transitions
+  // throw std::logic_error.
+  virtual void UpdateBatch(const Transition *transitions, std::size_t size);
+  // Learns from one player's side of a recorded episode: per move, the state
+  // it faced, the action it took and the reward it received before its next
+  // move, then the final state if the opponent ended the game. By default
+  // the moves become transitions for UpdateBatch.
+  virtual void UpdateEpisode(const std::vector<TimeStep> &time_steps);
   virtual void UpdateExploration(int episode) {}
 
  protected:
-  std::shared_ptr<Values> values_ = std::shared_ptr<Values>(new Values());
+  std::shared_ptr<ValueTable> values_ =
+      std::shared_ptr<ValueTable>(new ValueTable());
   Reward greedy_value_ = 0.0;
   std::vector<Action> legal_actions_;
   std::vector<Action> greedy_actions_;
+  State greedy_child_;
+  virtual const AgentFile::Policy *GetPolicyMap() const { return nullptr; }
+  virtual std::vector<ValueTable *> GetValueTables() const {
+    return {values_.get()};
+  }
+  virtual void Read(const AgentFile &file);
+  template<typename ValueOf>
+  Reward GreedyValue(const State &, ValueOf value_of, int *num_greedy_actions,
+                     std::vector<Action> *greedy_actions = nullptr);
+  Reward GreedyValue(const State &state, int *num_greedy_actions,
+                     std::vector<Action> *greedy_actions = nullptr) {
+    return GreedyValue(state,
+                       [this](const State &child) {
+                         return values_->Get(child);
+                       },
+                       num_greedy_actions, greedy_actions);
+  }
 };
 
+// Scans the children of a nonterminal state once, in the order of its legal
+// actions, and returns the highest value_of(child). The greedy actions are
+// collected into greedy_actions when it is given.
+template<typename ValueOf>
+Agent::Reward RLAgent::GreedyValue(const State &state, ValueOf value_of,
+                                   int *num_greedy_actions,
+                                   std::vector<Action> *greedy_actions) {
+  Reward greedy_value = 0.0;
+  *num_greedy_actions = 0;
+  if (greedy_actions) greedy_actions->clear();
+  // The children are made in place in a buffer that outlives the call, so
+  // that scanning them does not allocate once it has grown to fit.
+  greedy_child_ = state;
+  for (const auto &action : state.LegalActionsView()) {
+    greedy_child_.ApplyAction(action);
+    Reward value = value_of(greedy_child_);
+    greedy_child_.UndoAction(action);
+    if (!*num_greedy_actions || value > greedy_value) {
+      greedy_value = value;
+      *num_greedy_actions = 1;
+      if (greedy_actions) greedy_actions->clear();
+    } else if (value == greedy_value) {
+      ++*num_greedy_actions;
+    } else {
+      continue;
+    }
+    if (greedy_actions) greedy_actions->push_back(action);
+  }
+  return greedy_value;
+}
+
 std::ostream &operator<<(std::ostream &,
                          const std::unordered_map<State, Agent::Reward> &);
 
-std::ostream &operator<<(std::ostream &,
-                         const std::vector<RLAgent::TimeStep> &);
+std::ostream &operator<<(std::ostream &, const RLAgent::Trajectory &);
 
 }  // namespace nim_rl
 
@@ -13,23 +13,164 @@
 // limitations under the License.
 
 #include "nim_rl/agent/td_agent.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+
 #include "nim_rl/environment/game.h"
 
 namespace nim_rl {
 
+namespace {
+
+// The target value of the child that values rates highest, or zero if the
+// state is terminal.
+Agent::Reward GreedyTarget(const State &state, const ValueTable &values,
+                           const ValueTable &target_values) {
+  bool is_first_child = true;
+  Agent::Reward greedy_value = 0.0, target_value = 0.0;
+  for (const auto &child : state.ChildrenView()) {
+    Agent::Reward value = values.Get(child);
+    if (is_first_child || value > greedy_value) {
+      greedy_value = value;
+      target_value = &values == &target_values ? value
+                                               : target_values.Get(child);
+      is_first_child = false;
+    }
+  }
+  return target_value;
+}
+
+// The expected target value of the children under an epsilon greedy policy
+// on values, or zero if the state is terminal.
+Agent::Reward ExpectedTarget(const State &state, double epsilon,
+                             const ValueTable &values,
+                             const ValueTable &target_values) {
+  int num_children = 0, num_greedy_children = 0;
+  Agent::Reward greedy_value = 0.0;
+  for (const auto &child : state.ChildrenView()) {
+    Agent::Reward value = values.Get(child);
+    if (!num_children++ || value > greedy_value) {
+      greedy_value = value;
+      num_greedy_children = 1;
+    } else if (value == greedy_value) {
+      ++num_greedy_children;
+    }
+  }
+  Agent::Reward expectation = 0.0;
+  for (const auto &child : state.ChildrenView()) {
+    double prob = epsilon / num_children;
+    if (values.Get(child) == greedy_value)
+      prob += (1 - epsilon) / num_greedy_children;
+    expectation += prob * target_values.Get(child);
+  }
+  return expectation;
+}
+
+}  // namespace
+
+RLAgent::Hyperparameters TDAgent::GetHyperparameters() const {
+  return {{"alpha", alpha_},
+          {"epsilon", epsilon_greedy_.GetEpsilon()},
+          {"epsilon_decay_factor", epsilon_greedy_.GetEpsilonDecayFactor()},
+          {"gamma", gamma_},
+          {"min_epsilon", epsilon_greedy_.GetMinEpsilon()}};
+}
+
+void TDAgent::SetHyperparameters(const Hyperparameters &hyperparameters) {
+  alpha_ = hyperparameters.at("alpha");
+  epsilon_greedy_.SetEpsilon(hyperparameters.at("epsilon"));
+  epsilon_greedy_.SetEpsilonDecayFactor(
+      hyperparameters.at("epsilon_decay_factor"));
+  gamma_ = hyperparameters.at("gamma");
+  epsilon_greedy_.SetMinEpsilon(hyperparameters.at("min_epsilon"));
+}
+
 Action TDAgent::Step(Game *game, bool is_evaluation) {
   Reward reward = game->GetReward();
   Action action = Agent::Step(game, is_evaluation);
-  if (!is_evaluation) Update(current_state_, game->GetState(), -reward);
+  if (!is_evaluation) {
+    NIM_RL_COUNT(updates);
+    NIM_RL_TIME(update_seconds);
+    Update(current_state_, game->GetState(), -reward);
+  }
   return action;
 }
 
+void TDAgent::UpdateBatch(const Transition *transitions, std::size_t size) {
+  std::vector<Reward> targets(size);
+  std::vector<std::size_t> indices(size);
+  for (std::size_t i = 0; i != size; ++i) {
+    targets[i] = BatchTarget(transitions[i], *values_, *values_);
+    indices[i] = i;
+  }
+  ApplyBatch(transitions, targets.data(), indices, values_.get());
+}
+
+// Each state is ranked or hashed once. In a dense table the slot of the
+// update kPrefetchDistance ahead is prefetched, so that its cache miss
+// overlaps the updates before it.
+void TDAgent::ApplyBatch(const Transition *transitions, const Reward *targets,
+                         const std::vector<std::size_t> &indices,
+                         ValueTable *values) const {
+  constexpr std::size_t kPrefetchDistance = 8;
+  struct Slot {
+    bool is_rank;
+    std::size_t key;
+    std::size_t index;
+    bool operator<(const Slot &rhs) const {
+      return std::tie(is_rank, key, index)
+          < std::tie(rhs.is_rank, rhs.key, rhs.index);
+    }
+  };
+  std::vector<Slot> slots(indices.size());
+  for (std::size_t i = 0; i != indices.size(); ++i) {
+    slots[i].index = indices[i];
+    slots[i].key = values->SortKey(transitions[indices[i]].state,
+                                   &slots[i].is_rank);
+  }
+  std::sort(slots.begin(), slots.end());
+  // Consecutive updates of a state share one lookup.
+  const Slot *group = nullptr;
+  ValueTable::Value *value = nullptr;
+  for (std::size_t i = 0; i != slots.size(); ++i) {
+    if (i + kPrefetchDistance < slots.size()
+        && slots[i + kPrefetchDistance].is_rank)
+      values->PrefetchRank(slots[i + kPrefetchDistance].key);
+    const Slot &slot = slots[i];
+    const Transition &transition = transitions[slot.index];
+    if (transition.state.IsEmpty()) continue;
+    if (!group || group->is_rank != slot.is_rank || group->key != slot.key
+        || (!slot.is_rank
+            && !(transitions[group->index].state == transition.state))) {
+      group = &slot;
+      value = slot.is_rank ? &values->AtRank(slot.key)
+                           : &(*values)[transition.state];
+    }
+    *value += alpha_ * (targets[slot.index] - *value);
+  }
+}
+
+Agent::Reward TDAgent::BatchTarget(const Transition &,
+                                   const ValueTable &,
+                                   const ValueTable &) const {
+  throw std::logic_error(GetType() + " does not support batch updates.");
+}
+
+Agent::Reward QLearningAgent::BatchTarget(
+    const Transition &transition, const ValueTable &values,
+    const ValueTable &target_values) const {
+  return transition.reward
+      + gamma_ * GreedyTarget(transition.next_state, values, target_values);
+}
+
 void QLearningAgent::Update(const State &update_state,
                             const State &current_state,
                             Reward reward) {
   if (!update_state.IsEmpty())
     (*values_)[update_state] +=
-        alpha_ * (reward + gamma_ * greedy_value_ - (*values_)[update_state]);
+        alpha_ * (reward + gamma_ * greedy_value_ - values_->Get(update_state));
   current_state_ = current_state;
 }
 
@@ -38,16 +179,38 @@ void SarsaAgent::Update(const State &update_state,
                         Reward reward) {
   if (!update_state.IsEmpty())
     (*values_)[update_state] += alpha_
-        * (reward + gamma_ * (*values_)[current_state]
-            - (*values_)[update_state]);
+        * (reward + gamma_ * values_->Get(current_state)
+            - values_->Get(update_state));
   current_state_ = current_state;
 }
 
+Agent::Reward SarsaAgent::BatchTarget(const Transition &transition,
+                                      const ValueTable &,
+                                      const ValueTable &target_values) const {
+  if (transition.next_state.IsTerminal()) return transition.reward;
+  return transition.reward
+      + gamma_ * target_values.Get(transition.next_afterstate);
+}
+
 Action ExpectedSarsaAgent::Policy(const State &state, bool is_evaluation) {
-  SetNextStates(state.Children());
+  state.Children(&next_states_);
   return TDAgent::Policy(state, is_evaluation);
 }
 
+Agent::Reward ExpectedSarsaAgent::BatchTarget(
+    const Transition &transition, const ValueTable &values,
+    const ValueTable &target_values) const {
+  return transition.reward
+      + gamma_ * ExpectedTarget(transition.next_state,
+                                epsilon_greedy_.GetEpsilon(), values,
+                                target_values);
+}
+
+void ExpectedSarsaAgent::BindArena(Arena *arena) {
+  TDAgent::BindArena(arena);
+  next_states_ = ArenaVector<State>(ArenaAllocator<State>(arena));
+}
+
 void ExpectedSarsaAgent::Reset() {
   TDAgent::Reset();
   next_states_.clear();
@@ -61,58 +224,49 @@ void ExpectedSarsaAgent::Update(const State &update_state,
     double expectation = 0.0;
     if (!legal_actions_.empty()) {
       for (const auto &state : next_states_)
-        if ((*values_)[state] != greedy_value_)
-          expectation += epsilon * (*values_)[state] / legal_actions_.size();
+        if (values_->Get(state) != greedy_value_)
+          expectation += epsilon * values_->Get(state) / legal_actions_.size();
       expectation += (1 - epsilon) * greedy_value_
           + greedy_actions_.size() * epsilon * greedy_value_
               / legal_actions_.size();
     }
     (*values_)[update_state] +=
-        alpha_ * (reward + gamma_ * expectation - (*values_)[update_state]);
+        alpha_ * (reward + gamma_ * expectation - values_->Get(update_state));
   }
   current_state_ = current_state;
 }
 
 std::unordered_map<State, Agent::Reward>
 DoubleLearningAgent::GetValues() const {
-  Values values = Values(*values_);
-  for (const auto &kv : *values_2_)
-    values[kv.first] = (values[kv.first] + kv.second) / 2;
+  Values values;
+  for (const auto &kv : values_->GetValues())
+    values[kv.first] = (kv.second + values_2_->Get(kv.first)) / 2;
+  for (const auto &kv : values_2_->GetValues())
+    values[kv.first] = (values_->Get(kv.first) + kv.second) / 2;
   return values;
 }
 
 void
 DoubleLearningAgent::Initialize(const std::vector<State> &all_states) {
   TDAgent::Initialize(all_states);
-  *values_2_ = *values_;
+  if (!values_2_->IsDense()) *values_2_ = *values_;
 }
 
 Action DoubleLearningAgent::Policy(const State &state, bool is_evaluation) {
-  legal_actions_ = state.LegalActions();
+  state.LegalActions(&legal_actions_);
   greedy_actions_.clear();
   if (legal_actions_.empty()) {
     greedy_value_ = 0.0;
     return Action{};
   } else {
-    Action greedy_action =
-        *std::max_element(legal_actions_.begin(), legal_actions_.end(),
-                          [&](const Action &a1, const Action &a2) -> bool {
-                            State state1 = state.Child(a1);
-                            State state2 = state.Child(a2);
-                            return (*values_)[state1] + (*values_2_)[state1] <
-                                (*values_)[state2] + (*values_2_)[state2];
-                          });
-    State greedy_state = state.Child(greedy_action);
-    greedy_value_ = ((*values_)[greedy_state] + (*values_2_)[greedy_state]) / 2;
-    std::copy_if(legal_actions_.begin(), legal_actions_.end(),
-                 std::back_inserter(greedy_actions_),
-                 [&state, this](const Action &action) -> bool {
-                   State next_state = state.Child(action);
-                   return
-                       ((*values_)[next_state] + (*values_2_)[next_state]) / 2
-                           == greedy_value_;
-                 });
-    flag_ = dist_flag_(rng_);
+    int num_greedy_actions;
+    greedy_value_ = GreedyValue(
+        state,
+        [this](const State &child) {
+          return (values_->Get(child) + values_2_->Get(child)) / 2;
+        },
+        &num_greedy_actions, &greedy_actions_);
+    flag_ = RandomEngine().Bernoulli(0.5);
     if (is_evaluation) {
       return SampleAction(greedy_actions_);
     } else {
@@ -134,112 +288,126 @@ void DoubleLearningAgent::Update(const State &update_state,
   current_state_ = current_state;
 }
 
+void DoubleLearningAgent::UpdateBatch(const Transition *transitions,
+                                      std::size_t size) {
+  std::vector<Reward> targets(size);
+  std::vector<std::size_t> indices, indices_2;
+  for (std::size_t i = 0; i != size; ++i) {
+    if (RandomEngine().Bernoulli(0.5)) {
+      targets[i] = BatchTarget(transitions[i], *values_, *values_2_);
+      indices.push_back(i);
+    } else {
+      targets[i] = BatchTarget(transitions[i], *values_2_, *values_);
+      indices_2.push_back(i);
+    }
+  }
+  ApplyBatch(transitions, targets.data(), indices, values_.get());
+  ApplyBatch(transitions, targets.data(), indices_2, values_2_.get());
+}
+
 void DoubleQLearningAgent::DoUpdate(const State &update_state,
                                     const State &/*current_state*/,
                                     Reward reward,
-                                    Values *values) {
+                                    ValueTable *values) {
   if (!update_state.IsEmpty())
     (*values)[update_state] += alpha_
-        * (reward + gamma_ * greedy_value_ - (*values)[update_state]);
+        * (reward + gamma_ * greedy_value_ - values->Get(update_state));
+}
+
+Agent::Reward DoubleQLearningAgent::BatchTarget(
+    const Transition &transition, const ValueTable &values,
+    const ValueTable &target_values) const {
+  return transition.reward
+      + gamma_ * GreedyTarget(transition.next_state, values, target_values);
 }
 
 Action DoubleQLearningAgent::Policy(const State &state,
                                         bool is_evaluation) {
   Action action = DoubleLearningAgent::Policy(state, is_evaluation);
-  greedy_actions_.clear();
   if (!legal_actions_.empty()) {
-    Action greedy_action;
-    if (flag_) {
-      greedy_action =
-          *std::max_element(legal_actions_.begin(), legal_actions_.end(),
-                            [&](const Action &a1, const Action &a2) {
-                              return (*values_)[state.Child(a1)] <
-                                  (*values_)[state.Child(a2)];
-                            });
-      greedy_value_ = (*values_2_)[state.Child(greedy_action)];
-    } else {
-      greedy_action =
-          *std::max_element(legal_actions_.begin(), legal_actions_.end(),
-                            [&](const Action &a1, const Action &a2) {
-                              return (*values_2_)[state.Child(a1)] <
-                                  (*values_2_)[state.Child(a2)];
-                            });
-      greedy_value_ = (*values_)[state.Child(greedy_action)];
-    }
+    ValueTable *values = flag_ ? values_.get() : values_2_.get();
+    ValueTable *target_values = flag_ ? values_2_.get() : values_.get();
+    int num_greedy_actions;
+    GreedyValue(state,
+                [values](const State &child) { return values->Get(child); },
+                &num_greedy_actions, &greedy_actions_);
+    greedy_value_ = target_values->Get(state.Child(greedy_actions_.front()));
   }
+  greedy_actions_.clear();
   return action;
 }
 
 void DoubleSarsaAgent::DoUpdate(const State &update_state,
                                 const State &current_state,
                                 Reward reward,
-                                Values *values) {
+                                ValueTable *values) {
   if (!update_state.IsEmpty()) {
     if (values == values_.get()) {
       (*values)[update_state] += alpha_
-          * (reward + gamma_ * (*values_2_)[current_state]
-              - (*values)[update_state]);
+          * (reward + gamma_ * values_2_->Get(current_state)
+              - values->Get(update_state));
     } else {
       (*values)[update_state] += alpha_
-          * (reward + gamma_ * (*values_)[current_state]
-              - (*values)[update_state]);
+          * (reward + gamma_ * values_->Get(current_state)
+              - values->Get(update_state));
     }
   }
 }
 
+Agent::Reward DoubleSarsaAgent::BatchTarget(
+    const Transition &transition, const ValueTable &,
+    const ValueTable &target_values) const {
+  if (transition.next_state.IsTerminal()) return transition.reward;
+  return transition.reward
+      + gamma_ * target_values.Get(transition.next_afterstate);
+}
+
 void DoubleExpectedSarsaAgent::DoUpdate(const State &update_state,
                                         const State &/*current_state*/,
                                         Reward reward,
-                                        Values *values) {
+                                        ValueTable *values) {
   double epsilon = epsilon_greedy_.GetEpsilon();
   if (!update_state.IsEmpty()) {
     double expectation = 0.0;
     if (!legal_actions_.empty()) {
       if (values == values_.get()) {
         for (const auto &state : next_states_)
-          if ((*values_2_)[state] != greedy_value_)
+          if (values_2_->Get(state) != greedy_value_)
             expectation +=
-                (*values_2_)[state] * epsilon / legal_actions_.size();
+                values_2_->Get(state) * epsilon / legal_actions_.size();
       } else if (values == values_2_.get()) {
         for (const auto &state : next_states_)
-          if ((*values_)[state] != greedy_value_)
-            expectation += (*values_)[state] * epsilon / legal_actions_.size();
+          if (values_->Get(state) != greedy_value_)
+            expectation +=
+                values_->Get(state) * epsilon / legal_actions_.size();
       }
       expectation += (1 - epsilon) * greedy_value_
           + greedy_actions_.size() * epsilon * greedy_value_
               / legal_actions_.size();
     }
     (*values)[update_state] +=
-        alpha_ * (reward + gamma_ * expectation - (*values)[update_state]);
+        alpha_ * (reward + gamma_ * expectation - values->Get(update_state));
   }
 }
 
 Action DoubleExpectedSarsaAgent::Policy(const State &state,
                                         bool is_evaluation) {
-  SetNextStates(state.Children());
-  Action action = DoubleLearningAgent::Policy(state, is_evaluation);
-  greedy_actions_.clear();
-  if (!legal_actions_.empty()) {
-    Action greedy_action =
-        *std::max_element(legal_actions_.begin(), legal_actions_.end(),
-                          [&](const Action &a1, const Action &a2) {
-                            State state1 = state.Child(a1);
-                            State state2 = state.Child(a2);
-                            return (*values_)[state1] + (*values_2_)[state1] <
-                                (*values_)[state2] + (*values_2_)[state2];
-                          });
-    greedy_value_ = ((*values_)[state.Child(greedy_action)]
-        + (*values_2_)[state.Child(greedy_action)]) / 2;
-    std::copy_if(legal_actions_.begin(), legal_actions_.end(),
-                 std::back_inserter(greedy_actions_),
-                 [&](const Action &action) {
-                   State next_state = state.Child(action);
-                   return
-                       ((*values_)[next_state] + (*values_2_)[next_state]) / 2
-                           == greedy_value_;
-                 });
-  }
-  return action;
+  state.Children(&next_states_);
+  return DoubleLearningAgent::Policy(state, is_evaluation);
+}
+
+Agent::Reward DoubleExpectedSarsaAgent::BatchTarget(
+    const Transition &transition, const ValueTable &values,
+    const ValueTable &target_values) const {
+  return transition.reward
+      + gamma_ * ExpectedTarget(transition.next_state,
+                                epsilon_greedy_.GetEpsilon(), values,
+                                target_values);
+}
+
+void DoubleExpectedSarsaAgent::BindArena(Arena *arena) {
+  DoubleLearningAgent::BindArena(arena);
+  next_states_ = ArenaVector<State>(ArenaAllocator<State>(arena));
 }
 
 void DoubleExpectedSarsaAgent::Reset() {
@@ -38,15 +38,26 @@ class TDAgent : public RLAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new TDAgent(*this));
   }
+  std::string GetType() const override { return "TDAgent"; }
   double GetAlpha() const { return alpha_; }
   double GetGamma() const { return gamma_; }
+  Hyperparameters GetHyperparameters() const override;
   Action PolicyImpl(const std::vector<Action> &legal_actions,
                     const std::vector<Action> &greedy_actions) override {
     return epsilon_greedy_.Explore(legal_actions, greedy_actions);
   }
+  void PolicyImplProbs(const std::vector<Action> &legal_actions,
+                       const std::vector<Action> &greedy_actions,
+                       ActionProbs *probs) const override {
+    epsilon_greedy_.GetActionProbs(legal_actions, greedy_actions, probs);
+  }
   void SetAlpha(double alpha) { alpha_ = alpha; }
   void SetGamma(double gamma) { gamma_ = gamma; }
+  void SetHyperparameters(const Hyperparameters &) override;
   Action Step(Game *, bool is_evaluation) override;
+  // Computes every target from the values before the batch, then applies the
+  // updates grouped by state, in the order the values are stored.
+  void UpdateBatch(const Transition *transitions, std::size_t size) override;
   void UpdateExploration(int episode) override {
     epsilon_greedy_.Update(episode);
   }
@@ -55,6 +66,14 @@ class TDAgent : public RLAgent {
   double alpha_;
   double gamma_;
   EpsilonGreedy epsilon_greedy_;
+  void ApplyBatch(const Transition *transitions, const Reward *targets,
+                  const std::vector<std::size_t> &indices,
+                  ValueTable *values) const;
+  // The target of a transition. Greedy actions are chosen by values and
+  // evaluated by target_values, which differ for double learning.
+  virtual Reward BatchTarget(const Transition &transition,
+                             const ValueTable &values,
+                             const ValueTable &target_values) const;
 };
 
 class QLearningAgent : public TDAgent {
@@ -74,8 +93,13 @@ class QLearningAgent : public TDAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new QLearningAgent(*this));
   }
+  std::string GetType() const override { return "QLearningAgent"; }
   void Update(const State &update_state, const State &current_state,
               Reward reward) override;
+
+ protected:
+  Reward BatchTarget(const Transition &transition, const ValueTable &values,
+                     const ValueTable &target_values) const override;
 };
 
 class SarsaAgent : public TDAgent {
@@ -94,8 +118,13 @@ class SarsaAgent : public TDAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new SarsaAgent(*this));
   }
+  std::string GetType() const override { return "SarsaAgent"; }
   void Update(const State &update_state, const State &current_state,
               Reward reward) override;
+
+ protected:
+  Reward BatchTarget(const Transition &transition, const ValueTable &values,
+                     const ValueTable &target_values) const override;
 };
 
 class ExpectedSarsaAgent : public TDAgent {
@@ -115,16 +144,22 @@ class ExpectedSarsaAgent : public TDAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new ExpectedSarsaAgent(*this));
   }
+  std::string GetType() const override { return "ExpectedSarsaAgent"; }
   Action Policy(const State &, bool is_evaluation) override;
   void Reset() override;
   void Update(const State &update_state, const State &current_state,
               Reward reward) override;
 
+ protected:
+  Reward BatchTarget(const Transition &transition, const ValueTable &values,
+                     const ValueTable &target_values) const override;
+  void BindArena(Arena *arena) override;
+
  private:
-  std::vector<State> next_states_;
-  template<typename T>
-  void SetNextStates(T &&next_states) {
-    next_states_ = std::forward<T>(next_states);
+  ArenaVector<State> next_states_;
+  void SetNextStates(std::vector<State> next_states) {
+    next_states_.assign(std::make_move_iterator(next_states.begin()),
+                        std::make_move_iterator(next_states.end()));
   }
 };
 
@@ -143,24 +178,53 @@ class DoubleLearningAgent : public TDAgent {
   DoubleLearningAgent &operator=(DoubleLearningAgent &&) = default;
   ~DoubleLearningAgent() override = default;
   virtual void DoUpdate(const State &update_state, const State &current_state,
-                        Reward reward, Values *values) = 0;
+                        Reward reward, ValueTable *values) = 0;
+  void CompactValues(const State &initial_state, Precision precision,
+                     std::size_t cache_capacity
+                         = kDefaultValueCacheCapacity) override {
+    values_->Compact(initial_state, precision, cache_capacity);
+    values_2_->Compact(initial_state, precision, cache_capacity);
+  }
+  void FlushValues() override {
+    values_->Flush();
+    values_2_->Flush();
+  }
+  Reward GetValue(const State &state) const override {
+    return (values_->Get(state) + values_2_->Get(state)) / 2;
+  }
   Values GetValues() const override;
   void Initialize(const std::vector<State> &) override;
+  // The second estimate goes to path with ".2" appended.
+  void MapValues(const std::string &path, const State &initial_state,
+                 Precision precision = Precision::kFloat64,
+                 std::size_t cache_capacity
+                     = kDefaultValueCacheCapacity) override {
+    values_->Map(path, initial_state, precision, cache_capacity);
+    values_2_->Map(path + ".2", initial_state, precision, cache_capacity);
+  }
   Action Policy(const State &, bool is_evaluation) override;
   void Reset() override;
+  void SetLazy(bool is_lazy) override {
+    values_->SetLazy(is_lazy);
+    values_2_->SetLazy(is_lazy);
+  }
   void SetValues(const Values &values) override {
-    *values_ = *values_2_ = values;
+    values_->SetValues(values);
+    values_2_->SetValues(values);
   }
   void Update(const State &update_state, const State &current_state,
               Reward reward) override;
+  // Updates each transition into one of the estimates at random, with
+  // targets evaluated by the other.
+  void UpdateBatch(const Transition *transitions, std::size_t size) override;
 
  protected:
-  std::shared_ptr<Values> values_2_ = std::shared_ptr<Values>(new Values());
+  std::shared_ptr<ValueTable> values_2_ =
+      std::shared_ptr<ValueTable>(new ValueTable());
   bool flag_ = false;
-
- private:
-  std::bernoulli_distribution dist_flag_{};
-  std::mt19937 rng_{std::random_device{}()};
+  std::vector<ValueTable *> GetValueTables() const override {
+    return {values_.get(), values_2_.get()};
+  }
 };
 
 class DoubleQLearningAgent : public DoubleLearningAgent {
@@ -181,9 +245,14 @@ class DoubleQLearningAgent : public DoubleLearningAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new DoubleQLearningAgent(*this));
   }
+  std::string GetType() const override { return "DoubleQLearningAgent"; }
   void DoUpdate(const State &update_state, const State &current_state,
-                Reward reward, Values *values) override;
+                Reward reward, ValueTable *values) override;
   Action Policy(const State &, bool is_evaluation) override;
+
+ protected:
+  Reward BatchTarget(const Transition &transition, const ValueTable &values,
+                     const ValueTable &target_values) const override;
 };
 
 class DoubleSarsaAgent : public DoubleLearningAgent {
@@ -204,8 +273,13 @@ class DoubleSarsaAgent : public DoubleLearningAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new DoubleSarsaAgent(*this));
   }
+  std::string GetType() const override { return "DoubleSarsaAgent"; }
   void DoUpdate(const State &update_state, const State &current_state,
-                Reward reward, Values *values) override;
+                Reward reward, ValueTable *values) override;
+
+ protected:
+  Reward BatchTarget(const Transition &transition, const ValueTable &values,
+                     const ValueTable &target_values) const override;
 };
 
 class DoubleExpectedSarsaAgent : public DoubleLearningAgent {
@@ -227,16 +301,22 @@ class DoubleExpectedSarsaAgent : public DoubleLearningAgent {
   std::shared_ptr<Agent> Clone() const override {
     return std::shared_ptr<Agent>(new DoubleExpectedSarsaAgent(*this));
   }
+  std::string GetType() const override { return "DoubleExpectedSarsaAgent"; }
   void DoUpdate(const State &update_state, const State &current_state,
-                Reward reward, Values *values) override;
+                Reward reward, ValueTable *values) override;
   Action Policy(const State &, bool is_evaluation) override;
   void Reset() override;
 
+ protected:
+  Reward BatchTarget(const Transition &transition, const ValueTable &values,
+                     const ValueTable &target_values) const override;
+  void BindArena(Arena *arena) override;
+
  private:
-  std::vector<State> next_states_;
-  template<typename T>
-  void SetNextStates(T &&next_states) {
-    next_states_ = std::forward<T>(next_states);
+  ArenaVector<State> next_states_;
+  void SetNextStates(std::vector<State> next_states) {
+    next_states_.assign(std::make_move_iterator(next_states.begin()),
+                        std::make_move_iterator(next_states.end()));
   }
 };
 
@@ -0,0 +1,130 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/agent/value_table.h"
+
+#include <stdexcept>
+#include <utility>
+
+#include "nim_rl/environment/game.h"
+
+namespace nim_rl {
+
+namespace {
+
+// Values lie between the lose and the win reward, which kInt8 tables span.
+constexpr ValueTable::Value kInt8Scale =
+    (kWinReward > -kLoseReward ? kWinReward : -kLoseReward) / 127;
+
+}  // namespace
+
+ValueTable::Value ValueTable::InitialValue(const State &state) {
+  return !state.IsEmpty() && state.IsTerminal() ? kWinReward : kTieReward;
+}
+
+void ValueTable::Clear() {
+  values_.clear();
+  if (dense_) {
+    dense_->Clear();
+    InitializeDense();
+  }
+}
+
+void ValueTable::Compact(const State &initial_state, Precision precision,
+                         std::size_t cache_capacity) {
+  if (dense_) values_ = GetValues();
+  dense_ = std::make_shared<DenseValues>(initial_state, precision, kInt8Scale,
+                                         cache_capacity);
+  MoveIntoDense();
+}
+
+void ValueTable::Flush() {
+  if (dense_) dense_->Flush();
+}
+
+const std::string &ValueTable::GetPath() const {
+  if (!IsMapped()) throw std::runtime_error("Value table is not mapped.");
+  return dense_->GetPath();
+}
+
+const StateRange &ValueTable::GetStateRange() const {
+  if (!dense_) throw std::runtime_error("Value table is not dense.");
+  return dense_->GetStateRange();
+}
+
+ValueTable::Values ValueTable::GetValues() const {
+  if (!dense_) return values_;
+  Values values = values_;
+  const StateRange &state_range = dense_->GetStateRange();
+  values.reserve(values.size() + state_range.Size());
+  for (auto iter = state_range.begin(); iter != state_range.end(); ++iter)
+    values.emplace(*iter, dense_->Get(iter.GetRank()));
+  return values;
+}
+
+void ValueTable::Map(const std::string &path, const State &initial_state,
+                     Precision precision, std::size_t cache_capacity) {
+  if (dense_) values_ = GetValues();
+  dense_ = std::make_shared<DenseValues>(path, initial_state, precision,
+                                         kInt8Scale, cache_capacity);
+  MoveIntoDense();
+}
+
+void ValueTable::MapCopyOnWrite(std::shared_ptr<MappedFile> file,
+                                std::size_t offset,
+                                const State &initial_state,
+                                Precision precision,
+                                std::size_t cache_capacity) {
+  values_.clear();
+  dense_ = std::make_shared<DenseValues>(std::move(file), offset,
+                                         initial_state, precision,
+                                         cache_capacity);
+}
+
+void ValueTable::SetValues(const Values &values) {
+  if (!dense_) {
+    values_ = values;
+    return;
+  }
+  Clear();
+  for (const auto &kv : values) (*this)[kv.first] = kv.second;
+}
+
+std::size_t ValueTable::Size() const {
+  return values_.size() + (dense_ ? dense_->Size() : 0);
+}
+
+// Zeroed values already hold the tie reward, so only the terminal state, the
+// first in rank order, needs its initial value.
+void ValueTable::InitializeDense() {
+  State terminal_state = dense_->GetStateRange().Unrank(0);
+  (*dense_)[0] = InitialValue(terminal_state);
+}
+
+// Moves the values of the dense states out of the map. A dense table that
+// already existed keeps its own values instead.
+void ValueTable::MoveIntoDense() {
+  if (dense_->IsCreated()) InitializeDense();
+  for (auto iter = values_.begin(); iter != values_.end();) {
+    StateRange::Rank rank;
+    if (dense_->Find(iter->first, &rank)) {
+      if (dense_->IsCreated()) (*dense_)[rank] = iter->second;
+      iter = values_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+}  // namespace nim_rl
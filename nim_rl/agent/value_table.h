@@ -0,0 +1,142 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_AGENT_VALUE_TABLE_H_
+#define NIM_RL_AGENT_VALUE_TABLE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "nim_rl/agent/dense_values.h"
+#include "nim_rl/state/state.h"
+#include "nim_rl/state/state_range.h"
+#include "nim_rl/stats/stats.h"
+
+namespace nim_rl {
+
+// State values of an RL agent. Get never inserts: a state that has not been
+// written reads as its initial value, a win for terminal states and a tie
+// otherwise. In lazy mode agents rely on that instead of storing the initial
+// value of every state up front, so only states that training touches are
+// ever stored.
+//
+// A dense table keeps the values of the states of one initial state in an
+// array indexed by rank instead (see DenseValues), possibly at a lower
+// precision, and keeps only the states outside that state space, such as the
+// empty state, in the map. A mapped table is a dense table in a file, so it
+// may outgrow memory, and a table loaded from an agent file reads the file's
+// array copy-on-write. Copies of a dense table share the array.
+class ValueTable {
+ public:
+  using Value = double;
+  using Values = std::unordered_map<State, Value>;
+  ValueTable() = default;
+  explicit ValueTable(bool is_lazy) : is_lazy_(is_lazy) {}
+  ValueTable(const ValueTable &) = default;
+  ValueTable(ValueTable &&) = default;
+  ValueTable &operator=(const ValueTable &) = default;
+  ValueTable &operator=(ValueTable &&) = default;
+  ~ValueTable() = default;
+  static Value InitialValue(const State &state);
+  void Clear();
+  // Stores the values of the states reachable from initial_state densely at
+  // the given precision, keeping those stored so far. kInt8 covers the
+  // range of the rewards.
+  void Compact(const State &initial_state, Precision precision,
+               std::size_t cache_capacity = kDefaultValueCacheCapacity);
+  // Writes cached values of a dense table through to its array.
+  void Flush();
+  Value Get(const State &state) const {
+    NIM_RL_COUNT(lookups);
+    StateRange::Rank rank;
+    if (dense_ && dense_->Find(state, &rank)) return dense_->Get(rank);
+    NIM_RL_COUNT_N(probes, ProbeLength(state));
+    auto iter = values_.find(state);
+    return iter != values_.end() ? iter->second : InitialValue(state);
+  }
+  const std::string &GetPath() const;
+  Precision GetPrecision() const {
+    return dense_ ? dense_->GetPrecision() : Precision::kFloat64;
+  }
+  // Every state of the table's state space, in the order of its StateRange.
+  const StateRange &GetStateRange() const;
+  // Copies a dense table into a map, state by state.
+  Values GetValues() const;
+  bool IsLazy() const { return is_lazy_; }
+  bool IsDense() const { return static_cast<bool>(dense_); }
+  bool IsMapped() const { return dense_ && dense_->IsMapped(); }
+  // Moves the table into the file at path. A new file receives the values
+  // stored so far; an existing file must hold the states reachable from
+  // initial_state and keeps its values and precision, which replace those in
+  // memory.
+  void Map(const std::string &path, const State &initial_state,
+           Precision precision = Precision::kFloat64,
+           std::size_t cache_capacity = kDefaultValueCacheCapacity);
+  // Replaces the table with the values from offset on in a file mapped
+  // copy-on-write, see DenseValues.
+  void MapCopyOnWrite(std::shared_ptr<MappedFile> file, std::size_t offset,
+                      const State &initial_state, Precision precision,
+                      std::size_t cache_capacity
+                          = kDefaultValueCacheCapacity);
+  void Set(const State &state, Value value) { (*this)[state] = value; }
+  void SetLazy(bool is_lazy) { is_lazy_ = is_lazy; }
+  void SetValues(const Values &values);
+  std::size_t Size() const;
+  // Orders states by where their values are stored: by rank in a dense
+  // table, by hash otherwise. Equal states have equal keys. Sets *is_rank
+  // to whether the key is a rank, which AtRank and PrefetchRank take.
+  std::size_t SortKey(const State &state, bool *is_rank) const {
+    StateRange::Rank rank;
+    *is_rank = dense_ && dense_->Find(state, &rank);
+    return *is_rank ? static_cast<std::size_t>(rank)
+                    : std::hash<State>()(state);
+  }
+  // Like operator[] for the state of rank in a dense table.
+  Value &AtRank(StateRange::Rank rank) {
+    NIM_RL_COUNT(lookups);
+    return (*dense_)[rank];
+  }
+  void PrefetchRank(StateRange::Rank rank) const { dense_->Prefetch(rank); }
+  // Reference to the stored value, storing the initial value first if needed.
+  Value &operator[](const State &state) {
+    NIM_RL_COUNT(lookups);
+    StateRange::Rank rank;
+    if (dense_ && dense_->Find(state, &rank)) return (*dense_)[rank];
+    NIM_RL_COUNT_N(probes, ProbeLength(state));
+    auto iter = values_.find(state);
+    if (iter == values_.end()) {
+      NIM_RL_COUNT(inserts);
+      iter = values_.emplace(state, InitialValue(state)).first;
+    }
+    return iter->second;
+  }
+
+ private:
+  Values values_;
+  std::shared_ptr<DenseValues> dense_;
+  bool is_lazy_ = false;
+  void InitializeDense();
+  void MoveIntoDense();
+  // The entries in the bucket of the state, which a lookup may compare.
+  std::size_t ProbeLength(const State &state) const {
+    return values_.bucket_count() ? values_.bucket_size(values_.bucket(state))
+                                  : 0;
+  }
+};
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_AGENT_VALUE_TABLE_H_
@@ -0,0 +1,76 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nim_rl/bench/agent_registry.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "nim_rl/agent/dp_agent.h"
+#include "nim_rl/agent/monte_carlo_agent.h"
+#include "nim_rl/agent/n_step_bootstrapping_agent.h"
+#include "nim_rl/agent/td_agent.h"
+#include "nim_rl/bench/flags.h"
+
+namespace nim_rl {
+
+namespace {
+
+template<typename T>
+std::pair<const std::string, AgentEntry> Entry(AgentKind kind) {
+  return {T().GetType(), {kind, [] { return std::make_shared<T>(); }}};
+}
+
+}  // namespace
+
+const std::map<std::string, AgentEntry> &Agents() {
+  static const std::map<std::string, AgentEntry> agents{
+      Entry<QLearningAgent>(AgentKind::kTD),
+      Entry<SarsaAgent>(AgentKind::kTD),
+      Entry<ExpectedSarsaAgent>(AgentKind::kTD),
+      Entry<DoubleQLearningAgent>(AgentKind::kTD),
+      Entry<DoubleSarsaAgent>(AgentKind::kTD),
+      Entry<DoubleExpectedSarsaAgent>(AgentKind::kTD),
+      Entry<NStepSarsaAgent>(AgentKind::kEpisodic),
+      Entry<NStepExpectedSarsaAgent>(AgentKind::kEpisodic),
+      Entry<OffPolicyNStepSarsaAgent>(AgentKind::kEpisodic),
+      Entry<OffPolicyNStepExpectedSarsaAgent>(AgentKind::kEpisodic),
+      Entry<NStepTreeBackupAgent>(AgentKind::kEpisodic),
+      Entry<ESMonteCarloAgent>(AgentKind::kEpisodic),
+      Entry<OnPolicyMonteCarloAgent>(AgentKind::kEpisodic),
+      Entry<OffPolicyMonteCarloAgent>(AgentKind::kEpisodic),
+      Entry<PolicyIterationAgent>(AgentKind::kDP),
+      Entry<ValueIterationAgent>(AgentKind::kDP)};
+  return agents;
+}
+
+std::vector<std::string> AgentTypes(std::initializer_list<AgentKind> kinds) {
+  std::vector<std::string> types;
+  for (const auto &kv : Agents())
+    if (std::find(kinds.begin(), kinds.end(), kv.second.kind) != kinds.end())
+      types.push_back(kv.first);
+  return types;
+}
+
+std::vector<std::string> ParseAgentTypes(const std::string &list) {
+  std::vector<std::string> types = SplitList(list);
+  for (const auto &type : types)
+    if (!Agents().count(type))
+      throw std::invalid_argument("Unknown agent " + type);
+  return types;
+}
+
+}  // namespace nim_rl
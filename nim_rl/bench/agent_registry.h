@@ -0,0 +1,53 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NIM_RL_BENCH_AGENT_REGISTRY_H_
+#define NIM_RL_BENCH_AGENT_REGISTRY_H_
+
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nim_rl/agent/rl_agent.h"
+
+namespace nim_rl {
+
+using AgentFactory = std::function<std::shared_ptr<RLAgent>()>;
+
+// How an agent learns: by a TD update after every step, by updates that wait
+// n steps or until the end of the episode, or by DP on the transition model.
+enum class AgentKind { kTD, kEpisodic, kDP };
+
+struct AgentEntry {
+  AgentKind kind;
+  AgentFactory factory;
+};
+
+// Every RL agent by its type, for the drivers that pick agents by name.
+const std::map<std::string, AgentEntry> &Agents();
+
+// The types of the agents of the given kinds, in alphabetical order.
+std::vector<std::string> AgentTypes(std::initializer_list<AgentKind> kinds);
+
+// Checks the types of a comma-separated list against Agents(), throwing
+// std::invalid_argument for the first unknown one.
+std::vector<std::string> ParseAgentTypes(const std::string &list);
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_BENCH_AGENT_REGISTRY_H_
@@ -0,0 +1,97 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nim_rl/bench/alloc_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#define malloc_usable_size malloc_size
+#else
+#include <malloc.h>
+#endif
+
+namespace {
+
+std::atomic<std::size_t> num_allocations{0};
+std::atomic<std::size_t> num_bytes{0};
+std::atomic<std::size_t> live_bytes{0};
+
+void *CountedAllocate(std::size_t size) {
+  void *p = std::malloc(size ? size : 1);
+  if (p) {
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    num_bytes.fetch_add(size, std::memory_order_relaxed);
+    live_bytes.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+  }
+  return p;
+}
+
+void CountedFree(void *p) {
+  if (p)
+    live_bytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+  std::free(p);
+}
+
+}  // namespace
+
+// Defined apart from their callers, so that no call is inlined into a free
+// of memory the compiler takes for operator new's. The array and sized forms
+// forward to the plain scalar ones, as the standard library's do.
+void *operator new(std::size_t size) {
+  if (void *p = CountedAllocate(size)) return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return CountedAllocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void *p) noexcept { CountedFree(p); }
+
+void operator delete[](void *p) noexcept { ::operator delete(p); }
+
+void operator delete(void *p, std::size_t) noexcept { ::operator delete(p); }
+
+void operator delete[](void *p, std::size_t) noexcept {
+  ::operator delete[](p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  ::operator delete(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  ::operator delete[](p);
+}
+
+namespace nim_rl {
+
+AllocCounts GetAllocCounts() {
+  return {num_allocations.load(std::memory_order_relaxed),
+          num_bytes.load(std::memory_order_relaxed),
+          live_bytes.load(std::memory_order_relaxed)};
+}
+
+}  // namespace nim_rl
@@ -0,0 +1,38 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NIM_RL_BENCH_ALLOC_COUNTER_H_
+#define NIM_RL_BENCH_ALLOC_COUNTER_H_
+
+#include <cstddef>
+
+namespace nim_rl {
+
+// The heap allocations of a program that links alloc_counter.cpp, which
+// replaces the global operators new and delete with counting ones. The
+// counts cover every allocation since the program started.
+struct AllocCounts {
+  std::size_t num_allocations;
+  // The bytes asked for, freed or not.
+  std::size_t num_bytes;
+  // The bytes allocated and not yet freed, as malloc reports them.
+  std::size_t live_bytes;
+};
+
+AllocCounts GetAllocCounts();
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_BENCH_ALLOC_COUNTER_H_
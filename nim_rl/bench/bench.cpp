@@ -0,0 +1,305 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Micro-benchmarks of the hot paths of training, each run for several
+// initial states. Results are printed as Google Benchmark JSON, so that two
+// releases compare with its tools/compare.py:
+//
+//   nim_bench --benchmark_out=bench.json --benchmark_filter='Hash|Train'
+//
+// Any other Google Benchmark flag may be given; --benchmark_format=console
+// prints a table instead. Build with -DCMAKE_BUILD_TYPE=Release for numbers
+// worth comparing.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nim_rl/agent/dp_agent.h"
+#include "nim_rl/agent/n_step_bootstrapping_agent.h"
+#include "nim_rl/agent/optimal_agent.h"
+#include "nim_rl/agent/td_agent.h"
+#include "nim_rl/bench/agent_registry.h"
+#include "nim_rl/environment/game.h"
+#include "nim_rl/environment/typed_game.h"
+#include "nim_rl/state/state_space.h"
+
+using namespace nim_rl;
+
+namespace {
+
+const std::vector<State> &InitialStates() {
+  static const std::vector<State> states{
+      State({3, 3, 3}), State({10, 10, 10}), State({20, 20, 20, 20})};
+  return states;
+}
+
+std::string Name(const std::string &name, const State &state) {
+  std::string piles;
+  for (int pile_id = 0; pile_id != state.Size(); ++pile_id)
+    piles += (pile_id ? "," : "") + std::to_string(state[pile_id]);
+  return name + "/" + piles;
+}
+
+// A copy, since the cached StateSpace goes once nobody holds it.
+std::vector<State> AllStates(const State &state) {
+  return StateSpace::Get(state)->GetStates();
+}
+
+// Every non-terminal state, so that each has a legal action.
+std::vector<State> LiveStates(const State &state) {
+  std::vector<State> states;
+  for (const auto &s : AllStates(state))
+    if (!s.IsTerminal()) states.push_back(s);
+  return states;
+}
+
+// Runs body on the states in turn, one per iteration.
+template<typename Body>
+void ForEachState(benchmark::State &bench_state,
+                  const std::vector<State> &states, Body body) {
+  std::size_t index = 0;
+  for (auto _ : bench_state) {
+    body(states[index]);
+    if (++index == states.size()) index = 0;
+  }
+  bench_state.SetItemsProcessed(bench_state.iterations());
+}
+
+void Hash(benchmark::State &bench_state, const State &initial_state) {
+  std::hash<State> hash;
+  ForEachState(bench_state, AllStates(initial_state),
+               [&](const State &state) {
+                 benchmark::DoNotOptimize(hash(state));
+               });
+}
+
+void Equal(benchmark::State &bench_state, const State &initial_state) {
+  std::vector<State> states = AllStates(initial_state), copies = states;
+  std::size_t index = 0;
+  for (auto _ : bench_state) {
+    benchmark::DoNotOptimize(states[index] == copies[index]);
+    if (++index == states.size()) index = 0;
+  }
+  bench_state.SetItemsProcessed(bench_state.iterations());
+}
+
+void LegalActions(benchmark::State &bench_state,
+                  const State &initial_state) {
+  std::vector<Action> actions;
+  ForEachState(bench_state, AllStates(initial_state),
+               [&](const State &state) {
+                 state.LegalActions(&actions);
+                 benchmark::DoNotOptimize(actions.data());
+               });
+}
+
+void Children(benchmark::State &bench_state, const State &initial_state) {
+  std::vector<State> children;
+  ForEachState(bench_state, AllStates(initial_state),
+               [&](const State &state) {
+                 state.Children(&children);
+                 benchmark::DoNotOptimize(children.data());
+               });
+}
+
+void GetAllStates(benchmark::State &bench_state,
+                  const State &initial_state) {
+  for (auto _ : bench_state)
+    benchmark::DoNotOptimize(initial_state.GetAllStates());
+  bench_state.counters["states"] =
+      static_cast<double>(AllStates(initial_state).size());
+}
+
+void Policy(benchmark::State &bench_state, const State &initial_state) {
+  SeedRandomEngine(0);
+  QLearningAgent agent;
+  agent.Initialize(AllStates(initial_state));
+  ForEachState(bench_state, LiveStates(initial_state),
+               [&](const State &state) {
+                 benchmark::DoNotOptimize(agent.Policy(state, false));
+               });
+}
+
+void OptimalPolicy(benchmark::State &bench_state,
+                   const State &initial_state) {
+  SeedRandomEngine(0);
+  OptimalAgent agent;
+  ForEachState(bench_state, LiveStates(initial_state),
+               [&](const State &state) {
+                 benchmark::DoNotOptimize(agent.Policy(state, false));
+               });
+}
+
+// Updates the value of a state towards the value of one of its children,
+// with the greedy value of the previous Policy call, as a step of training
+// does.
+void Update(benchmark::State &bench_state, const State &initial_state,
+            const AgentFactory &factory) {
+  SeedRandomEngine(0);
+  std::shared_ptr<RLAgent> agent = factory();
+  agent->Initialize(AllStates(initial_state));
+  std::vector<std::pair<State, State>> transitions;
+  for (const auto &state : LiveStates(initial_state)) {
+    agent->Policy(state, false);
+    transitions.emplace_back(state, state.Child(SampleAction(state)));
+  }
+  std::size_t index = 0;
+  for (auto _ : bench_state) {
+    agent->Update(transitions[index].first, transitions[index].second, 0.0);
+    if (++index == transitions.size()) index = 0;
+  }
+  bench_state.SetLabel(agent->GetType());
+  bench_state.SetItemsProcessed(bench_state.iterations());
+}
+
+void DPInitialize(benchmark::State &bench_state, const State &initial_state,
+                  const std::shared_ptr<DPAgent> &agent) {
+  std::vector<State> states = AllStates(initial_state);
+  // The agents report each sweep on std::cout, which holds the JSON.
+  std::streambuf *cout_buffer = std::cout.rdbuf(nullptr);
+  for (auto _ : bench_state) agent->Initialize(states);
+  std::cout.rdbuf(cout_buffer);
+  std::cout.clear();
+  bench_state.SetLabel(agent->GetType());
+  bench_state.counters["states"] = static_cast<double>(states.size());
+}
+
+// Self-play episodes as Game::Train plays them, without its initialization
+// and checkpoints, in episodes per second.
+void Episode(benchmark::State &bench_state, const State &initial_state,
+             const AgentFactory &factory) {
+  SeedRandomEngine(0);
+  std::shared_ptr<RLAgent> agent = factory();
+  Game game(initial_state);
+  game.SetFirstPlayer(*agent);
+  game.SetSecondPlayer(*agent);
+  std::vector<State> states = AllStates(initial_state);
+  game.GetFirstPlayer()->Initialize(states);
+  game.GetSecondPlayer()->Initialize(states);
+  game.Reset();
+  for (auto _ : bench_state) {
+    while (true) {
+      game.GetFirstPlayer()->Step(&game, false);
+      if (game.IsTerminal()) {
+        game.GetSecondPlayer()->Step(&game, false);
+        break;
+      }
+      game.GetSecondPlayer()->Step(&game, false);
+      if (game.IsTerminal()) {
+        game.GetFirstPlayer()->Step(&game, false);
+        break;
+      }
+    }
+    game.Reset();
+  }
+  bench_state.SetLabel(agent->GetType());
+  bench_state.SetItemsProcessed(bench_state.iterations());
+}
+
+// Self-play through Game::Train, including its initialization and
+// checkpoints, in episodes per second.
+void Train(benchmark::State &bench_state, const State &initial_state,
+           const AgentFactory &factory) {
+  constexpr int kEpisodes = 10 * kCheckPoint;
+  std::shared_ptr<RLAgent> agent = factory();
+  Game game(initial_state);
+  game.SetSeed(0);
+  game.SetVerbose(false);
+  game.SetFirstPlayer(*agent);
+  game.SetSecondPlayer(*agent);
+  for (auto _ : bench_state) game.Train(kEpisodes);
+  bench_state.SetLabel(agent->GetType());
+  bench_state.SetItemsProcessed(bench_state.iterations() * kEpisodes);
+}
+
+// The same through TypedGame, which calls the players by their types.
+template<typename T>
+void TypedTrain(benchmark::State &bench_state, const State &initial_state) {
+  constexpr int kEpisodes = 10 * kCheckPoint;
+  T agent;
+  TypedGame<T, T> game(initial_state, agent, agent);
+  game.SetSeed(0);
+  game.SetVerbose(false);
+  for (auto _ : bench_state) game.Train(kEpisodes);
+  bench_state.SetLabel(agent.GetType());
+  bench_state.SetItemsProcessed(bench_state.iterations() * kEpisodes);
+}
+
+void RegisterBenchmarks() {
+  for (const auto &state : InitialStates()) {
+    benchmark::RegisterBenchmark(Name("Hash", state).c_str(), Hash, state);
+    benchmark::RegisterBenchmark(Name("Equal", state).c_str(), Equal, state);
+    benchmark::RegisterBenchmark(Name("LegalActions", state).c_str(),
+                                 LegalActions, state);
+    benchmark::RegisterBenchmark(Name("Children", state).c_str(), Children,
+                                 state);
+    benchmark::RegisterBenchmark(Name("GetAllStates", state).c_str(),
+                                 GetAllStates, state)
+        ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(Name("Policy", state).c_str(), Policy,
+                                 state);
+    benchmark::RegisterBenchmark(Name("OptimalPolicy", state).c_str(),
+                                 OptimalPolicy, state);
+    for (const auto &type : AgentTypes({AgentKind::kTD}))
+      benchmark::RegisterBenchmark(Name("Update/" + type, state).c_str(),
+                                   Update, state, Agents().at(type).factory);
+    for (const auto &agent : std::vector<std::shared_ptr<DPAgent>>{
+             std::make_shared<PolicyIterationAgent>(),
+             std::make_shared<ValueIterationAgent>()})
+      benchmark::RegisterBenchmark(
+          Name("DPInitialize/" + agent->GetType(), state).c_str(),
+          DPInitialize, state, agent)
+          ->Unit(benchmark::kMillisecond);
+    for (const auto &type :
+         AgentTypes({AgentKind::kTD, AgentKind::kEpisodic})) {
+      const AgentFactory &factory = Agents().at(type).factory;
+      benchmark::RegisterBenchmark(Name("Episode/" + type, state).c_str(),
+                                   Episode, state, factory);
+      benchmark::RegisterBenchmark(Name("Train/" + type, state).c_str(),
+                                   Train, state, factory)
+          ->Unit(benchmark::kMillisecond);
+    }
+    benchmark::RegisterBenchmark(
+        Name("TypedTrain/QLearningAgent", state).c_str(),
+        TypedTrain<QLearningAgent>, state)
+        ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(
+        Name("TypedTrain/NStepSarsaAgent", state).c_str(),
+        TypedTrain<NStepSarsaAgent>, state)
+        ->Unit(benchmark::kMillisecond);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // JSON unless the command line asks for another format.
+  std::vector<char *> args{argv[0]};
+  std::string format = "--benchmark_format=json";
+  args.push_back(&format[0]);
+  args.insert(args.end(), argv + 1, argv + argc);
+  int num_args = static_cast<int>(args.size());
+  benchmark::Initialize(&num_args, args.data());
+  if (benchmark::ReportUnrecognizedArguments(num_args, args.data())) return 1;
+  RegisterBenchmarks();
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
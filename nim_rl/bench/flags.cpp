@@ -0,0 +1,53 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/bench/flags.h"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace nim_rl {
+
+bool ParseFlags(int argc, char **argv, const FlagParser &parse) {
+  for (int i = 1; i != argc; ++i)
+    if (!std::strcmp(argv[i], "--help") || !std::strcmp(argv[i], "-h"))
+      return false;
+  for (int i = 1; i != argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 2, "--") || arg.size() == 2)
+      throw std::invalid_argument("Expected --name=value, got " + arg);
+    std::size_t equal = arg.find('=');
+    if (equal == std::string::npos) {
+      parse(arg.substr(2), "true");
+    } else {
+      parse(arg.substr(2, equal - 2), arg.substr(equal + 1));
+    }
+  }
+  return true;
+}
+
+State ParseState(const std::string &name, const std::string &list) {
+  return State(ParseNumbers<unsigned>(name, list));
+}
+
+std::vector<std::string> SplitList(const std::string &list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) items.push_back(item);
+  return items;
+}
+
+}  // namespace nim_rl
@@ -0,0 +1,73 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_BENCH_FLAGS_H_
+#define NIM_RL_BENCH_FLAGS_H_
+
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "nim_rl/state/state.h"
+
+namespace nim_rl {
+
+using FlagParser =
+    std::function<void(const std::string &name, const std::string &value)>;
+
+// Hands every --name=value argument of the command line to parse, a bare
+// --name as --name=true. Returns false without parsing the rest if --help
+// or -h is given. Throws std::invalid_argument for other arguments; parse
+// throws it for names it does not know.
+bool ParseFlags(int argc, char **argv, const FlagParser &parse);
+
+// The value of flag name as a number of type T. Throws
+// std::invalid_argument naming the flag unless all of value is one.
+template<typename T>
+T ParseNumber(const std::string &name, const std::string &value) {
+  std::istringstream stream(value);
+  T number;
+  bool is_negative = value.find('-') != std::string::npos;
+  if (!(stream >> number) || !stream.eof()
+      || (std::is_unsigned<T>::value && is_negative))
+    throw std::invalid_argument("Invalid value " + value + " for --" + name);
+  return number;
+}
+
+// The values of flag name as a comma-separated list of numbers.
+template<typename T>
+std::vector<T> ParseNumbers(const std::string &name,
+                            const std::string &list);
+
+// The initial state of flag name as a comma-separated list of pile sizes.
+State ParseState(const std::string &name, const std::string &list);
+
+// The items of a comma-separated list.
+std::vector<std::string> SplitList(const std::string &list);
+
+template<typename T>
+std::vector<T> ParseNumbers(const std::string &name,
+                            const std::string &list) {
+  std::vector<T> numbers;
+  for (const auto &item : SplitList(list))
+    numbers.push_back(ParseNumber<T>(name, item));
+  return numbers;
+}
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_BENCH_FLAGS_H_
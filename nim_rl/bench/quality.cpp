@@ -0,0 +1,159 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures how long each agent takes to learn the game: trains it by
+// self-play with seeds 0 to seeds - 1 until its optimal actions ratio, the
+// share of N-positions where it agrees with OptimalAgent, reaches the target,
+// and writes the episodes, moves and wall seconds that took to a CSV file:
+//
+//   nim_quality --agents=QLearningAgent,NStepSarsaAgent --target=0.99
+//       --seeds=10 --max_episodes=200000 --state=10,10,10
+//       --output=quality.csv
+//
+// Each row holds the mean and the sample variance over the seeds that
+// reached the target within max_episodes, and how many did. The seconds
+// leave out the evaluations at the checkpoints, which are the benchmark's
+// own, so the runs are timed one at a time.
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nim_rl/agent/rl_agent.h"
+#include "nim_rl/bench/agent_registry.h"
+#include "nim_rl/bench/flags.h"
+#include "nim_rl/environment/game.h"
+
+using namespace nim_rl;
+
+namespace {
+
+struct Options {
+  std::vector<std::string> agents;
+  double target = 0.99;
+  int seeds = 10;
+  int max_episodes = 200000;
+  State state{10, 10, 10};
+  std::string output = "quality.csv";
+};
+
+constexpr char kUsage[] =
+    "Usage: nim_quality [--name=value...]\n"
+    "  --agents=LIST        agents to train (all)\n"
+    "  --target=RATIO       optimal actions ratio to reach (0.99)\n"
+    "  --seeds=N            runs per agent (10)\n"
+    "  --max_episodes=N     self-play episodes before giving up (200000)\n"
+    "  --state=LIST         pile sizes of the initial state (10,10,10)\n"
+    "  --output=PATH        CSV file to write (quality.csv)\n";
+
+// Returns false if the usage was asked for.
+bool ParseOptions(int argc, char **argv, Options *options) {
+  for (const auto &kv : Agents()) options->agents.push_back(kv.first);
+  bool is_parsed = ParseFlags(argc, argv, [&](const std::string &name,
+                                              const std::string &value) {
+    if (name == "agents") {
+      options->agents = ParseAgentTypes(value);
+    } else if (name == "target") {
+      options->target = ParseNumber<double>(name, value);
+    } else if (name == "seeds") {
+      options->seeds = ParseNumber<int>(name, value);
+    } else if (name == "max_episodes") {
+      options->max_episodes = ParseNumber<int>(name, value);
+    } else if (name == "state") {
+      options->state = ParseState(name, value);
+    } else if (name == "output") {
+      options->output = value;
+    } else {
+      throw std::invalid_argument("Unknown option " + name);
+    }
+  });
+  if (!is_parsed) return false;
+  if (options->seeds <= 0 || options->max_episodes < 0)
+    throw std::invalid_argument("Seeds must > 0 and max_episodes must >= 0");
+  return true;
+}
+
+// The mean and the sample variance, or blanks without samples.
+void WriteMeanAndVariance(const std::vector<double> &samples,
+                          std::ostream *out) {
+  if (samples.empty()) {
+    *out << ",,";
+    return;
+  }
+  double mean = 0.0, variance = 0.0;
+  for (double sample : samples) mean += sample;
+  mean /= samples.size();
+  for (double sample : samples) variance += (sample - mean) * (sample - mean);
+  if (samples.size() > 1) variance /= samples.size() - 1;
+  *out << ',' << mean << ',' << variance;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  try {
+    if (!ParseOptions(argc, argv, &options)) {
+      std::cout << kUsage;
+      return 0;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n' << kUsage;
+    return 1;
+  }
+  std::ofstream out(options.output);
+  if (!out) {
+    std::cerr << "Cannot write " << options.output << std::endl;
+    return 1;
+  }
+  out << "agent,target,seeds,reached,episodes_mean,episodes_variance,"
+         "steps_mean,steps_variance,seconds_mean,seconds_variance\n";
+  for (const auto &name : options.agents) {
+    std::vector<double> episodes, steps, seconds;
+    for (int seed = 0; seed != options.seeds; ++seed) {
+      std::shared_ptr<RLAgent> agent = Agents().at(name).factory();
+      Game game(options.state);
+      game.SetSeed(static_cast<std::uint64_t>(seed));
+      game.SetStopRatio(options.target);
+      game.SetVerbose(false);
+      game.SetFirstPlayer(*agent);
+      game.SetSecondPlayer(*agent);
+      TrainStats stats;
+      // The DP agents report every sweep on std::cout.
+      std::streambuf *cout_buffer = std::cout.rdbuf(nullptr);
+      double ratio = game.Train(options.max_episodes, &stats).first.back();
+      std::cout.rdbuf(cout_buffer);
+      std::cout.clear();
+      if (ratio < options.target) continue;
+      episodes.push_back(stats.episodes);
+      steps.push_back(static_cast<double>(stats.steps));
+      seconds.push_back(stats.total_seconds - stats.checkpoint_seconds);
+    }
+    std::cerr << name << ": " << episodes.size() << " of " << options.seeds
+              << " seeds reached " << options.target << std::endl;
+    out << name << ',' << options.target << ',' << options.seeds << ','
+        << episodes.size();
+    WriteMeanAndVariance(episodes, &out);
+    WriteMeanAndVariance(steps, &out);
+    WriteMeanAndVariance(seconds, &out);
+    out << '\n';
+    out.flush();
+  }
+  return 0;
+}
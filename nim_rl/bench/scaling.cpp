@@ -0,0 +1,232 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures how training scales with the state space. For every uniform
+// initial state of min_piles to max_piles piles of each size, writes one CSV
+// row with the number of states, the time and live heap bytes that
+// GetAllStates, a value table and the DP transition model take, the self-play
+// steps per second of each agent family and the time value iteration takes
+// to converge:
+//
+//   nim_scaling --min_piles=3 --max_piles=8 --sizes=4,8,16,32,64
+//       --max_states=1000000 --max_dp_states=20000 --output=scaling.csv
+//
+// States with more than max_states states are listed without measurements,
+// and DP is skipped beyond max_dp_states. Bytes are those allocated through
+// operator new and not yet freed, as malloc reports them.
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nim_rl/agent/dp_agent.h"
+#include "nim_rl/agent/td_agent.h"
+#include "nim_rl/bench/agent_registry.h"
+#include "nim_rl/bench/alloc_counter.h"
+#include "nim_rl/bench/flags.h"
+#include "nim_rl/environment/game.h"
+
+using namespace nim_rl;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// An agent family and the agent that stands for it.
+struct Family {
+  std::string name;
+  std::string agent;
+};
+
+const std::vector<Family> &Families() {
+  static const std::vector<Family> families{
+      {"td", "QLearningAgent"},
+      {"double_td", "DoubleQLearningAgent"},
+      {"n_step", "NStepSarsaAgent"},
+      {"monte_carlo", "OnPolicyMonteCarloAgent"}};
+  return families;
+}
+
+struct Options {
+  int min_piles = 3;
+  int max_piles = 8;
+  std::vector<unsigned> sizes{4, 8, 16, 32, 64};
+  std::uint64_t max_states = 1000000;
+  std::uint64_t max_dp_states = 20000;
+  int episodes = 200;
+  std::string output = "scaling.csv";
+};
+
+constexpr char kUsage[] =
+    "Usage: nim_scaling [--name=value...]\n"
+    "  --min_piles=N        fewest piles (3)\n"
+    "  --max_piles=N        most piles (8)\n"
+    "  --sizes=LIST         objects in each pile (4,8,16,32,64)\n"
+    "  --max_states=N       most states to measure (1000000)\n"
+    "  --max_dp_states=N    most states to run DP on (20000)\n"
+    "  --episodes=N         self-play episodes per family (200)\n"
+    "  --output=PATH        CSV file to write (scaling.csv)\n";
+
+// Returns false if the usage was asked for.
+bool ParseOptions(int argc, char **argv, Options *options) {
+  bool is_parsed = ParseFlags(argc, argv, [&](const std::string &name,
+                                              const std::string &value) {
+    if (name == "min_piles") {
+      options->min_piles = ParseNumber<int>(name, value);
+    } else if (name == "max_piles") {
+      options->max_piles = ParseNumber<int>(name, value);
+    } else if (name == "sizes") {
+      options->sizes = ParseNumbers<unsigned>(name, value);
+    } else if (name == "max_states") {
+      options->max_states = ParseNumber<std::uint64_t>(name, value);
+    } else if (name == "max_dp_states") {
+      options->max_dp_states = ParseNumber<std::uint64_t>(name, value);
+    } else if (name == "episodes") {
+      options->episodes = ParseNumber<int>(name, value);
+    } else if (name == "output") {
+      options->output = value;
+    } else {
+      throw std::invalid_argument("Unknown option " + name);
+    }
+  });
+  if (!is_parsed) return false;
+  if (options->min_piles <= 0 || options->max_piles < options->min_piles
+      || options->episodes <= 0)
+    throw std::invalid_argument("Expected 0 < min_piles <= max_piles and "
+                                "episodes > 0");
+  return true;
+}
+
+std::size_t LiveBytes() { return GetAllocCounts().live_bytes; }
+
+double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Self-play steps per second as Game::Train plays them, on values
+// initialized from states.
+double StepsPerSecond(const State &initial_state,
+                      const std::vector<State> &states, const RLAgent &agent,
+                      int episodes) {
+  Game game(initial_state);
+  game.SetVerbose(false);
+  game.SetFirstPlayer(agent);
+  game.SetSecondPlayer(agent);
+  // The players share their values, which one Initialize fills.
+  game.GetFirstPlayer()->Initialize(states);
+  Agent *players[] = {game.GetFirstPlayer().get(),
+                      game.GetSecondPlayer().get()};
+  SeedRandomEngine(0);
+  game.Reset();
+  std::uint64_t num_steps = 0;
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < episodes; ++i) {
+    int player = 0;
+    do {
+      players[player]->Step(&game, false);
+      player = 1 - player;
+      ++num_steps;
+    } while (!game.IsTerminal());
+    players[player]->Step(&game, false);
+    ++num_steps;
+    game.Reset();
+  }
+  return num_steps / SecondsSince(start);
+}
+
+void WriteRow(const Options &options, const State &state, std::ostream *out) {
+  std::uint64_t num_states = state.CountStates();
+  *out << state.Size() << ',' << state[0] << ',' << num_states;
+  if (num_states > options.max_states) {
+    *out << std::string(6 + Families().size(), ',') << '\n';
+    return;
+  }
+  std::size_t bytes = LiveBytes();
+  Clock::time_point start = Clock::now();
+  std::vector<State> states = state.GetAllStates();
+  *out << ',' << SecondsSince(start) << ',' << LiveBytes() - bytes;
+
+  std::size_t values_bytes;
+  {
+    QLearningAgent agent;
+    bytes = LiveBytes();
+    start = Clock::now();
+    agent.Initialize(states);
+    values_bytes = LiveBytes() - bytes;
+    *out << ',' << SecondsSince(start) << ',' << values_bytes;
+  }
+
+  for (const auto &family : Families())
+    *out << ','
+         << StepsPerSecond(state, states, *Agents().at(family.agent).factory(),
+                           options.episodes);
+
+  if (num_states > options.max_dp_states) {
+    *out << ",,\n";
+    return;
+  }
+  ValueIterationAgent agent;
+  bytes = LiveBytes();
+  // The agent reports every sweep on std::cout.
+  std::streambuf *cout_buffer = std::cout.rdbuf(nullptr);
+  start = Clock::now();
+  agent.Initialize(states);
+  double dp_seconds = SecondsSince(start);
+  std::cout.rdbuf(cout_buffer);
+  std::cout.clear();
+  // What the DP agent holds beyond a value table.
+  *out << ',' << LiveBytes() - bytes - values_bytes << ',' << dp_seconds
+       << '\n';
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  try {
+    if (!ParseOptions(argc, argv, &options)) {
+      std::cout << kUsage;
+      return 0;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n' << kUsage;
+    return 1;
+  }
+  std::ofstream out(options.output);
+  if (!out) {
+    std::cerr << "Cannot write " << options.output << std::endl;
+    return 1;
+  }
+  out << "piles,pile_size,states,all_states_seconds,all_states_bytes,"
+      << "initialize_seconds,values_bytes";
+  for (const auto &family : Families())
+    out << ',' << family.name << "_steps_per_second";
+  out << ",transitions_bytes,dp_seconds\n";
+  for (int num_piles = options.min_piles; num_piles <= options.max_piles;
+       ++num_piles) {
+    for (unsigned size : options.sizes) {
+      State state(static_cast<State::size_type>(num_piles), size);
+      std::cerr << state << ": " << state.CountStates() << " states"
+                << std::endl;
+      WriteRow(options, state, &out);
+      out.flush();
+    }
+  }
+  return 0;
+}
@@ -13,19 +13,42 @@
 // limitations under the License.
 
 #include "nim_rl/environment/game.h"
+#include "nim_rl/environment/typed_game.h"
 #include "nim_rl/agent/human_agent.h"
 #include "nim_rl/agent/rl_agent.h"
+#include "nim_rl/stats/tracer.h"
 
 namespace nim_rl {
 
+Game::Game(const Game &game)
+    : initial_state_(game.initial_state_),
+      state_(game.state_),
+      state_space_(game.state_space_),
+      reward_(game.reward_),
+      first_player_(game.first_player_),
+      second_player_(game.second_player_),
+      trajectory_log_(game.trajectory_log_),
+      episode_(game.episode_),
+      is_verbose_(game.is_verbose_),
+      stop_ratio_(game.stop_ratio_),
+      rng_(game.rng_),
+      is_seeded_(game.is_seeded_) {}
+
 Game &Game::operator=(const Game &rhs) {
   if (this != &rhs) {
     initial_state_ = rhs.initial_state_;
     state_ = rhs.state_;
-    all_states_ = rhs.all_states_;
+    state_space_ = rhs.state_space_;
     reward_ = rhs.reward_;
     first_player_ = rhs.first_player_;
     second_player_ = rhs.second_player_;
+    arena_ = std::make_shared<Arena>();
+    trajectory_log_ = rhs.trajectory_log_;
+    episode_ = rhs.episode_;
+    is_verbose_ = rhs.is_verbose_;
+    stop_ratio_ = rhs.stop_ratio_;
+    rng_ = rhs.rng_;
+    is_seeded_ = rhs.is_seeded_;
   }
   return *this;
 }
@@ -34,27 +57,42 @@ Game &Game::operator=(Game &&rhs) noexcept {
   if (this != &rhs) {
     initial_state_ = std::move(rhs.initial_state_);
     state_ = std::move(rhs.state_);
-    all_states_ = std::move(rhs.all_states_);
+    state_space_ = std::move(rhs.state_space_);
     reward_ = rhs.reward_;
     first_player_ = std::move(rhs.first_player_);
     second_player_ = std::move(rhs.second_player_);
+    arena_ = std::move(rhs.arena_);
+    trajectory_log_ = std::move(rhs.trajectory_log_);
+    episode_ = std::move(rhs.episode_);
+    is_verbose_ = rhs.is_verbose_;
+    stop_ratio_ = rhs.stop_ratio_;
+    rng_ = rhs.rng_;
+    is_seeded_ = rhs.is_seeded_;
   }
   return *this;
 }
 
+std::shared_ptr<const StateSpace> Game::GetStateSpace() const {
+  if (!state_space_) state_space_ = StateSpace::Get(initial_state_);
+  return state_space_;
+}
+
 void Game::Play(int episodes) {
   if (episodes < 0) throw std::invalid_argument("Episodes must >= 0");
   if (!first_player_ || !second_player_)
     throw std::runtime_error("Agent should not be nullptr");
   if (state_.IsEmpty()) throw std::runtime_error("State should not be empty");
+  RngScope rng_scope(is_seeded_ ? &rng_ : nullptr);
   double win_first_player = 0.0, win_second_player = 0.0;
   Action action;
   bool play_with_human = typeid(*first_player_) == typeid(HumanAgent) ||
       typeid(*second_player_) == typeid(HumanAgent);
+  episode_.is_evaluation = true;
   Reset();
   int cnt = 0;
   double average_episode_size_1 = 0.0, average_episode_size_2 = 0.0;
   for (int i = 0; i < episodes; ++i) {
+    NIM_RL_TRACE("Episode", "episode", i);
     ++cnt;
     int episode_size_1 = 0, episode_size_2 = 0;
     if (play_with_human) std::cout << "Game started." << std::endl;
@@ -96,12 +134,15 @@ void Game::Play(int episodes) {
     average_episode_size_2 += (episode_size_2 - average_episode_size_2) / cnt;
     Reset();
   }
-  std::cout << "average episode size: " << average_episode_size_1 << " "
-            << average_episode_size_2 << std::endl;
-  std::cout << std::fixed << std::setprecision(kPrecision)
-            << "player 1 winning percentage: " << win_first_player / episodes
-            << ", player 2 winning percentage: " << win_second_player / episodes
-            << std::endl;
+  if (trajectory_log_) trajectory_log_->Flush();
+  if (is_verbose_) {
+    std::cout << "average episode size: " << average_episode_size_1 << " "
+              << average_episode_size_2 << std::endl;
+    std::cout << std::fixed << std::setprecision(kPrecision)
+              << "player 1 winning percentage: " << win_first_player / episodes
+              << ", player 2 winning percentage: "
+              << win_second_player / episodes << std::endl;
+  }
 }
 
 void Game::PrintValues() const {
@@ -116,16 +157,34 @@ void Game::PrintValues() const {
 }
 
 void Game::Reset() {
+  if (trajectory_log_ && !episode_.actions.empty())
+    trajectory_log_->Append(episode_);
   state_ = initial_state_;
   reward_ = 0.0;
-  if (first_player_) first_player_->Reset();
+  RestartEpisode();
+  // Players drop everything they keep in the arena before it is recycled for
+  // the next episode.
+  if (first_player_) {
+    first_player_->Reset();
+    first_player_->SetArena(arena_);
+  }
   if (second_player_) {
     second_player_->Reset();
+    second_player_->SetArena(arena_);
     second_player_->current_state_ = state_;
   }
+  if (arena_) arena_->Reset();
+}
+
+void Game::RestartEpisode() {
+  episode_.initial_state = state_;
+  episode_.actions.clear();
+  episode_.rewards.clear();
 }
 
-void Game::Step(const Action &action) {
+const State &Game::Step(const Action &action) {
+  // The loser still steps once the game is over, which is not recorded.
+  bool is_recorded = trajectory_log_ && !state_.IsEmpty() && !IsTerminal();
   if (action.IsLegal(state_)) {
     state_.ApplyAction(action);
     reward_ = IsTerminal() ? kWinReward : kTieReward;
@@ -133,69 +192,33 @@ void Game::Step(const Action &action) {
     state_ = State();
     reward_ = kLoseReward;
   }
+  if (is_recorded) {
+    episode_.actions.push_back(action);
+    episode_.rewards.push_back(reward_);
+  }
+  return state_;
 }
 
-std::pair<std::vector<double>, std::vector<double>> Game::Train(int episodes) {
-  if (episodes < 0) throw std::invalid_argument("Episodes must >= 0");
-  if (!first_player_ || !second_player_)
-    throw std::runtime_error("Agent should not be nullptr");
-  if (state_.IsEmpty()) throw std::runtime_error("State should not be empty");
-  std::vector<double> optimal_action_ratios, mean_square_errors;
-  first_player_->Initialize(all_states_);
-  second_player_->Initialize(all_states_);
-  if (auto first_player = dynamic_cast<RLAgent *>(first_player_.get())) {
-    double optimal_action_ratio = first_player->OptimalActionsRatio();
-    optimal_action_ratios.push_back(optimal_action_ratio);
-    mean_square_errors.push_back(first_player->MinSquareError());
-    std::cout << "Epoch 1: " << optimal_action_ratio << std::endl;
-  }
-  Reset();
-  for (int i = 0; i < episodes; ++i) {
-    while (true) {
-      first_player_->Step(this, false);
-      if (IsTerminal()) {
-        second_player_->Step(this, false);
-        break;
-      }
-      second_player_->Step(this, false);
-      if (IsTerminal()) {
-        first_player_->Step(this, false);
-        break;
-      }
-    }
-    if (auto first_player = dynamic_cast<RLAgent *>(first_player_.get())) {
-      first_player->UpdateExploration(i);
-    }
-    if (auto second_player = dynamic_cast<RLAgent *>(second_player_.get())) {
-      second_player->UpdateExploration(i);
-    }
-    if ((i + 1) % kCheckPoint == 0) {
-      std::cout << "Epoch " << i + 1 << ":";
-      if (auto first_player = dynamic_cast<RLAgent *>(first_player_.get())) {
-        double optimal_action_ratio = first_player->OptimalActionsRatio();
-        double mean_square_error = first_player->MinSquareError();
-        optimal_action_ratios.push_back(optimal_action_ratio);
-        mean_square_errors.push_back(mean_square_error);
-        std::cout << optimal_action_ratio << std::endl;
-//        std::cout << " player 1 optimal actions ratio: "
-//                  << optimal_action_ratio << ", ";
-//        std::cout << "mean square error: " << first_player->MinSquareError()
-//                  << std::endl;
-      }
-    }
-    Reset();
-  }
-  return std::make_pair(optimal_action_ratios, mean_square_errors);
+std::pair<std::vector<double>, std::vector<double>> Game::Train(
+    int episodes, TrainStats *stats) {
+  return TrainWith(first_player_.get(), second_player_.get(), episodes, stats);
 }
 
 void swap(Game &lhs, Game &rhs) {
   using std::swap;
   swap(lhs.state_, rhs.state_);
   swap(lhs.initial_state_, rhs.initial_state_);
-  swap(lhs.all_states_, rhs.all_states_);
+  swap(lhs.state_space_, rhs.state_space_);
   swap(lhs.reward_, rhs.reward_);
   swap(lhs.first_player_, rhs.first_player_);
   swap(lhs.second_player_, rhs.second_player_);
+  swap(lhs.arena_, rhs.arena_);
+  swap(lhs.trajectory_log_, rhs.trajectory_log_);
+  swap(lhs.episode_, rhs.episode_);
+  swap(lhs.is_verbose_, rhs.is_verbose_);
+  swap(lhs.stop_ratio_, rhs.stop_ratio_);
+  swap(lhs.rng_, rhs.rng_);
+  swap(lhs.is_seeded_, rhs.is_seeded_);
 }
 
 }  // namespace nim_rl
@@ -16,8 +16,10 @@
 #define NIM_RL_ENVIRONMENT_GAME_H_
 
 #include <algorithm>
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 #include <utility>
@@ -25,7 +27,13 @@
 
 #include "nim_rl/action/action.h"
 #include "nim_rl/agent/agent.h"
+#include "nim_rl/environment/trajectory_log.h"
+#include "nim_rl/memory/arena.h"
+#include "nim_rl/random/rng.h"
 #include "nim_rl/state/state.h"
+#include "nim_rl/state/state_range.h"
+#include "nim_rl/state/state_space.h"
+#include "nim_rl/stats/stats.h"
 
 namespace nim_rl {
 
@@ -49,24 +57,40 @@ class Game {
   explicit Game(T &&state);
   template<typename T1, typename T2, typename T3>
   Game(T1 &&state, T2 &&first_player, T3 &&second_player);
-  Game(const Game &) = default;
+  // Copies play their episodes in an arena of their own.
+  Game(const Game &);
   Game(Game &&game) noexcept
       : initial_state_(std::move(game.initial_state_)),
         state_(std::move(game.state_)),
-        all_states_(std::move(game.all_states_)),
+        state_space_(std::move(game.state_space_)),
         reward_(game.reward_),
         first_player_(std::move(game.first_player_)),
-        second_player_(std::move(game.second_player_)) {}
+        second_player_(std::move(game.second_player_)),
+        arena_(std::move(game.arena_)),
+        trajectory_log_(std::move(game.trajectory_log_)),
+        episode_(std::move(game.episode_)),
+        is_verbose_(game.is_verbose_),
+        stop_ratio_(game.stop_ratio_),
+        rng_(game.rng_),
+        is_seeded_(game.is_seeded_) {}
   Game &operator=(const Game &);
   Game &operator=(Game &&) noexcept;
   ~Game() = default;
-  std::vector<State> GetAllStates() const { return all_states_; }
+  const std::vector<State> &GetAllStates() const {
+    return GetStateSpace()->GetStates();
+  }
   std::shared_ptr<Agent> GetFirstPlayer() const { return first_player_; }
-  State GetInitialState() const { return initial_state_; }
+  const State &GetInitialState() const { return initial_state_; }
   Reward GetReward() const { return reward_; }
   std::shared_ptr<Agent> GetSecondPlayer() const { return second_player_; }
-  State GetState() const { return state_; }
+  const State &GetState() const { return state_; }
+  StateRange GetStateRange() const { return StateRange(initial_state_); }
+  std::shared_ptr<const StateSpace> GetStateSpace() const;
+  std::shared_ptr<TrajectoryWriter> GetTrajectoryLog() const {
+    return trajectory_log_;
+  }
   bool IsTerminal() const { return state_.IsTerminal(); }
+  bool IsVerbose() const { return is_verbose_; }
   void Play(int episodes = 1);
   void PrintValues() const;
   void Render() const { std::cout << "Current state: " << state_ << std::endl; }
@@ -77,29 +101,77 @@ class Game {
   template<typename T>
   void SetInitialState(T &&init_state) {
     initial_state_ = std::forward<T>(init_state);
+    state_space_.reset();
   }
   void SetReward(Reward reward) { reward_ = reward; }
+  // Gives the game its own engine, which Train and Play install as the
+  // RandomEngine() of their thread, so that the players' choices are
+  // reproducible whichever thread runs the game. Unseeded games draw from
+  // the calling thread's engine. Copies continue the same sequence.
+  void SetSeed(std::uint64_t seed) {
+    rng_.Seed(seed);
+    is_seeded_ = true;
+  }
   void SetSecondPlayer(const Agent &second_player) {
     second_player_ = second_player.Clone();
   }
+  // A recorded episode restarts from the new state.
   template<typename T>
-  void SetState(T &&state) { state_ = std::forward<T>(state); }
-  void Step(const Action &);
-  std::pair<std::vector<double>, std::vector<double>> Train(int episodes = 0);
+  void SetState(T &&state) {
+    state_ = std::forward<T>(state);
+    if (trajectory_log_) RestartEpisode();
+  }
+  // Makes Train return at the first checkpoint where the first player's
+  // optimal actions ratio reaches ratio. None does by default.
+  void SetStopRatio(double ratio) { stop_ratio_ = ratio; }
+  // Records the episodes that Train and Play finish into log, or stops
+  // recording if log is nullptr. Copies of the game share the log.
+  void SetTrajectoryLog(std::shared_ptr<TrajectoryWriter> log) {
+    trajectory_log_ = std::move(log);
+    RestartEpisode();
+  }
+  // Whether Train and Play print their progress and results, which they do
+  // by default.
+  void SetVerbose(bool is_verbose) { is_verbose_ = is_verbose; }
+  // Returns the state the action leads to, which the game keeps until it
+  // changes again.
+  const State &Step(const Action &);
+  // Also fills *stats if it is not nullptr, with separate counters and
+  // timers for the two players even when they share their values.
+  std::pair<std::vector<double>, std::vector<double>> Train(
+      int episodes = 0, TrainStats *stats = nullptr);
+
+ protected:
+  // The body of Train, calling the players through their static types, which
+  // TypedGame narrows down. Defined in typed_game.h.
+  template<typename First, typename Second>
+  std::pair<std::vector<double>, std::vector<double>> TrainWith(
+      First *first_player, Second *second_player, int episodes,
+      TrainStats *stats);
 
  private:
   State initial_state_;
   State state_;
-  std::vector<State> all_states_;
+  // Fetched from the StateSpace cache on first use.
+  mutable std::shared_ptr<const StateSpace> state_space_;
   Reward reward_ = 0.0;
   std::shared_ptr<Agent> first_player_;
   std::shared_ptr<Agent> second_player_;
+  std::shared_ptr<Arena> arena_ = std::make_shared<Arena>();
+  std::shared_ptr<TrajectoryWriter> trajectory_log_;
+  Episode episode_;
+  bool is_verbose_ = true;
+  double stop_ratio_ = std::numeric_limits<double>::infinity();
+  Rng rng_;
+  bool is_seeded_ = false;
+  void RestartEpisode();
+  template<typename T>
+  void StepPlayer(T *player, AgentStats *stats);
 };
 
 template<typename T, typename>
 Game::Game(T &&state) : state_(std::forward<T>(state)) {
   initial_state_ = state_;
-  all_states_ = initial_state_.GetAllStates();
 }
 
 template<typename T1, typename T2, typename T3>
@@ -108,7 +180,6 @@ Game::Game(T1 &&state, T2 &&first_player, T3 &&second_player)
       first_player_(std::forward<T2>(first_player).Clone()),
       second_player_(std::forward<T3>(second_player).Clone()) {
   initial_state_ = state_;
-  all_states_ = initial_state_.GetAllStates();
 }
 
 void swap(Game &, Game &);
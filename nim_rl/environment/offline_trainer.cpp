@@ -0,0 +1,63 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/environment/offline_trainer.h"
+
+#include <stdexcept>
+#include <vector>
+
+namespace nim_rl {
+
+namespace {
+
+// The moves of one player, who moves at the even steps if player is 0, each
+// with the reward the player received before moving again.
+void GetTimeSteps(const Episode &episode, const std::vector<State> &states,
+                  std::size_t player,
+                  std::vector<RLAgent::TimeStep> *time_steps) {
+  time_steps->clear();
+  std::size_t num_steps = episode.actions.size();
+  for (std::size_t step = player; step < num_steps; step += 2) {
+    RLAgent::Reward reward = episode.rewards[step];
+    if (!reward && step + 1 < num_steps) reward = -episode.rewards[step + 1];
+    time_steps->emplace_back(states[step], episode.actions[step], reward);
+  }
+  if (num_steps && (num_steps - 1) % 2 != player)
+    time_steps->emplace_back(states.back(), Action(), 0.0);
+}
+
+}  // namespace
+
+std::size_t OfflineTrainer::Train(RLAgent *agent, int epochs,
+                                  bool include_evaluation) {
+  if (epochs < 0) throw std::invalid_argument("Epochs must >= 0");
+  std::size_t num_episodes = 0;
+  Episode episode;
+  std::vector<RLAgent::TimeStep> time_steps;
+  for (int epoch = 0; epoch != epochs; ++epoch) {
+    reader_.Rewind();
+    while (reader_.Next(&episode)) {
+      if (episode.is_evaluation && !include_evaluation) continue;
+      std::vector<State> states = episode.States();
+      for (std::size_t player = 0; player != 2; ++player) {
+        GetTimeSteps(episode, states, player, &time_steps);
+        agent->UpdateEpisode(time_steps);
+      }
+      ++num_episodes;
+    }
+  }
+  return num_episodes;
+}
+
+}  // namespace nim_rl
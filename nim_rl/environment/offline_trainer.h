@@ -0,0 +1,47 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_ENVIRONMENT_OFFLINE_TRAINER_H_
+#define NIM_RL_ENVIRONMENT_OFFLINE_TRAINER_H_
+
+#include <cstddef>
+#include <string>
+
+#include "nim_rl/agent/rl_agent.h"
+#include "nim_rl/environment/trajectory_log.h"
+
+namespace nim_rl {
+
+// Trains agents from the episodes of a trajectory log without playing, so
+// that one run of self-play serves many. As in self-play, the agent learns
+// both players' sides of every episode, through RLAgent::UpdateEpisode.
+class OfflineTrainer {
+ public:
+  explicit OfflineTrainer(const std::string &path) : reader_(path) {}
+  OfflineTrainer(const OfflineTrainer &) = delete;
+  OfflineTrainer &operator=(const OfflineTrainer &) = delete;
+  ~OfflineTrainer() = default;
+  // Passes over the log epochs times and returns the number of episodes
+  // learned from. Episodes recorded by Play are skipped unless
+  // include_evaluation is set.
+  std::size_t Train(RLAgent *agent, int epochs = 1,
+                    bool include_evaluation = false);
+
+ private:
+  TrajectoryReader reader_;
+};
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_ENVIRONMENT_OFFLINE_TRAINER_H_
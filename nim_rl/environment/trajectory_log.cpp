@@ -0,0 +1,217 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/environment/trajectory_log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace nim_rl {
+
+namespace {
+
+constexpr std::size_t kBufferSize = 1 << 16;
+constexpr std::uint8_t kEvaluation = 1;
+
+struct FileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved;
+};
+
+// Followed by the piles of the initial state and, per step, the pile id and
+// the number of objects of the action, all width bytes wide, and the reward
+// as a std::int8_t.
+struct EpisodeHeader {
+  std::uint32_t num_steps;
+  std::uint16_t num_piles;
+  std::uint8_t width;
+  std::uint8_t flags;
+};
+
+int Width(long long value) {
+  if (value >= std::numeric_limits<std::int8_t>::min()
+      && value <= std::numeric_limits<std::int8_t>::max())
+    return 1;
+  if (value >= std::numeric_limits<std::int16_t>::min()
+      && value <= std::numeric_limits<std::int16_t>::max())
+    return 2;
+  return 4;
+}
+
+void Put(std::vector<char> *buffer, long long value, int width) {
+  char bytes[4];
+  if (width == 1) {
+    auto narrow = static_cast<std::int8_t>(value);
+    std::memcpy(bytes, &narrow, width);
+  } else if (width == 2) {
+    auto narrow = static_cast<std::int16_t>(value);
+    std::memcpy(bytes, &narrow, width);
+  } else {
+    auto narrow = static_cast<std::int32_t>(value);
+    std::memcpy(bytes, &narrow, width);
+  }
+  buffer->insert(buffer->end(), bytes, bytes + width);
+}
+
+long long Get(const char *data, int width) {
+  if (width == 1) {
+    std::int8_t value;
+    std::memcpy(&value, data, width);
+    return value;
+  } else if (width == 2) {
+    std::int16_t value;
+    std::memcpy(&value, data, width);
+    return value;
+  }
+  std::int32_t value;
+  std::memcpy(&value, data, width);
+  return value;
+}
+
+}  // namespace
+
+std::vector<State> Episode::States() const {
+  std::vector<State> states;
+  states.reserve(actions.size() + 1);
+  states.push_back(initial_state);
+  State state = initial_state;
+  for (const auto &action : actions) {
+    if (action.IsLegal(state)) {
+      state.ApplyAction(action);
+    } else {
+      state = State();
+    }
+    states.push_back(state);
+  }
+  return states;
+}
+
+constexpr char TrajectoryWriter::kMagic[8];
+constexpr std::uint32_t TrajectoryWriter::kVersion;
+
+TrajectoryWriter::TrajectoryWriter(const std::string &path) : path_(path) {
+  FileHeader header{};
+  std::ifstream in(path, std::ios::binary);
+  bool is_new = !in.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (is_new && in.gcount())
+    throw std::runtime_error(path + " is not a trajectory log.");
+  in.close();
+  if (!is_new && (std::memcmp(header.magic, kMagic, sizeof(kMagic))
+      || header.version != kVersion))
+    throw std::runtime_error(path + " is not a trajectory log.");
+  out_.open(path, std::ios::binary | std::ios::app);
+  if (!out_) throw std::runtime_error("Cannot open " + path);
+  buffer_.reserve(kBufferSize);
+  if (is_new) {
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  }
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+  if (!out_.is_open()) return;
+  try {
+    Close();
+  } catch (const std::exception &) {
+  }
+}
+
+void TrajectoryWriter::Append(const Episode &episode) {
+  if (episode.actions.size() != episode.rewards.size())
+    throw std::invalid_argument("Every action needs a reward.");
+  const State &initial_state = episode.initial_state;
+  int num_piles = static_cast<int>(initial_state.Size());
+  int width = Width(num_piles - 1);
+  for (int pile_id = 0; pile_id != num_piles; ++pile_id)
+    width = std::max(width, Width(initial_state[pile_id]));
+  for (const auto &action : episode.actions)
+    width = std::max({width, Width(action.GetPileId()),
+                      Width(action.GetNumObjects())});
+  EpisodeHeader header{};
+  header.num_steps = static_cast<std::uint32_t>(episode.actions.size());
+  header.num_piles = static_cast<std::uint16_t>(num_piles);
+  header.width = static_cast<std::uint8_t>(width);
+  header.flags = episode.is_evaluation ? kEvaluation : 0;
+  const char *bytes = reinterpret_cast<const char *>(&header);
+  buffer_.insert(buffer_.end(), bytes, bytes + sizeof(header));
+  for (int pile_id = 0; pile_id != num_piles; ++pile_id)
+    Put(&buffer_, initial_state[pile_id], width);
+  for (std::size_t step = 0; step != episode.actions.size(); ++step) {
+    Put(&buffer_, episode.actions[step].GetPileId(), width);
+    Put(&buffer_, episode.actions[step].GetNumObjects(), width);
+    Put(&buffer_, std::lround(episode.rewards[step]), 1);
+  }
+  if (buffer_.size() >= kBufferSize) Flush();
+}
+
+void TrajectoryWriter::Close() {
+  Flush();
+  out_.close();
+  if (!out_) throw std::runtime_error("Cannot close " + path_);
+}
+
+void TrajectoryWriter::Flush() {
+  out_.write(buffer_.data(), buffer_.size());
+  out_.flush();
+  buffer_.clear();
+  if (!out_) throw std::runtime_error("Cannot write " + path_);
+}
+
+TrajectoryReader::TrajectoryReader(const std::string &path)
+    : file_(path, sizeof(FileHeader), MappedFile::Mode::kReadOnly),
+      offset_(sizeof(FileHeader)) {
+  auto *header = reinterpret_cast<const FileHeader *>(file_.GetData());
+  if (std::memcmp(header->magic, TrajectoryWriter::kMagic,
+                  sizeof(TrajectoryWriter::kMagic))
+      || header->version != TrajectoryWriter::kVersion)
+    throw std::runtime_error(path + " is not a trajectory log.");
+}
+
+bool TrajectoryReader::Next(Episode *episode) {
+  if (offset_ + sizeof(EpisodeHeader) > file_.GetSize()) return false;
+  EpisodeHeader header;
+  std::memcpy(&header, file_.GetData() + offset_, sizeof(header));
+  int width = header.width;
+  std::size_t size = sizeof(header) + header.num_piles * width
+      + header.num_steps * (2 * width + 1);
+  if (offset_ + size > file_.GetSize()) return false;
+  const char *data = file_.GetData() + offset_ + sizeof(header);
+  std::vector<unsigned> piles(header.num_piles);
+  for (auto &pile : piles) {
+    pile = static_cast<unsigned>(Get(data, width));
+    data += width;
+  }
+  episode->initial_state = State(std::move(piles));
+  episode->actions.resize(header.num_steps);
+  episode->rewards.resize(header.num_steps);
+  for (std::uint32_t step = 0; step != header.num_steps; ++step) {
+    int pile_id = static_cast<int>(Get(data, width));
+    int num_objects = static_cast<int>(Get(data + width, width));
+    episode->actions[step] = Action(pile_id, num_objects);
+    episode->rewards[step] = static_cast<double>(Get(data + 2 * width, 1));
+    data += 2 * width + 1;
+  }
+  episode->is_evaluation = header.flags & kEvaluation;
+  offset_ += size;
+  return true;
+}
+
+void TrajectoryReader::Rewind() { offset_ = sizeof(FileHeader); }
+
+}  // namespace nim_rl
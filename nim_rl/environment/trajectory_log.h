@@ -0,0 +1,87 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_ENVIRONMENT_TRAJECTORY_LOG_H_
+#define NIM_RL_ENVIRONMENT_TRAJECTORY_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "nim_rl/action/action.h"
+#include "nim_rl/memory/mapped_file.h"
+#include "nim_rl/state/state.h"
+
+namespace nim_rl {
+
+// A played episode: the actions taken from the initial state, alternating
+// between the players, and the reward each mover received. The states are
+// recovered by replaying the actions.
+struct Episode {
+  State initial_state;
+  std::vector<Action> actions;
+  std::vector<double> rewards;
+  bool is_evaluation = false;
+  // The state before each action, followed by the final state.
+  std::vector<State> States() const;
+};
+
+// Appends episodes to a log file, creating it if needed. Each action takes
+// two integers of the smallest width that fits the episode, one, two or four
+// bytes, and each reward one byte, since rewards are -1, 0 or 1. Episodes are
+// buffered and reach the file on Flush, Close or destruction. A destructor
+// cannot report a failed write, so call Close to learn of one.
+class TrajectoryWriter {
+ public:
+  static constexpr char kMagic[8] = {'N', 'I', 'M', 'T', 'R', 'A', 'J', 'S'};
+  static constexpr std::uint32_t kVersion = 1;
+  explicit TrajectoryWriter(const std::string &path);
+  TrajectoryWriter(const TrajectoryWriter &) = delete;
+  TrajectoryWriter &operator=(const TrajectoryWriter &) = delete;
+  ~TrajectoryWriter();
+  void Append(const Episode &episode);
+  // Flushes and closes the file. Appending afterwards fails.
+  void Close();
+  void Flush();
+  const std::string &GetPath() const { return path_; }
+
+ private:
+  std::string path_;
+  std::ofstream out_;
+  std::vector<char> buffer_;
+};
+
+// Reads the episodes of a log file in order through a read-only mapping.
+// Episodes appended after the reader was opened are not seen, and a last
+// episode cut short by a crash is ignored.
+class TrajectoryReader {
+ public:
+  explicit TrajectoryReader(const std::string &path);
+  TrajectoryReader(const TrajectoryReader &) = delete;
+  TrajectoryReader &operator=(const TrajectoryReader &) = delete;
+  ~TrajectoryReader() = default;
+  // Reads the next episode into *episode, or returns false after the last.
+  bool Next(Episode *episode);
+  void Rewind();
+
+ private:
+  MappedFile file_;
+  std::size_t offset_;
+};
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_ENVIRONMENT_TRAJECTORY_LOG_H_
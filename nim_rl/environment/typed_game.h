@@ -0,0 +1,245 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_ENVIRONMENT_TYPED_GAME_H_
+#define NIM_RL_ENVIRONMENT_TYPED_GAME_H_
+
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include "nim_rl/agent/rl_agent.h"
+#include "nim_rl/environment/game.h"
+#include "nim_rl/stats/tracer.h"
+
+namespace nim_rl {
+
+namespace internal {
+
+// The overloads for Agent dispatch at run time, the templates statically on
+// the exact type of the player.
+inline Action StepAgent(Agent *agent, Game *game, bool is_evaluation) {
+  return agent->Step(game, is_evaluation);
+}
+
+template<typename T>
+Action StepAgent(T *agent, Game *game, bool is_evaluation) {
+  return agent->T::Step(game, is_evaluation);
+}
+
+inline RLAgent *AsRLAgent(Agent *agent) {
+  return dynamic_cast<RLAgent *>(agent);
+}
+
+template<typename T>
+std::enable_if_t<std::is_base_of<RLAgent, T>::value, RLAgent *> AsRLAgent(
+    T *agent) {
+  return agent;
+}
+
+template<typename T>
+std::enable_if_t<!std::is_base_of<RLAgent, T>::value, RLAgent *> AsRLAgent(
+    T *) {
+  return nullptr;
+}
+
+inline void UpdateExploration(Agent *agent, int episode) {
+  if (auto rl_agent = dynamic_cast<RLAgent *>(agent))
+    rl_agent->UpdateExploration(episode);
+}
+
+template<typename T>
+std::enable_if_t<std::is_base_of<RLAgent, T>::value> UpdateExploration(
+    T *agent, int episode) {
+  agent->T::UpdateExploration(episode);
+}
+
+template<typename T>
+std::enable_if_t<!std::is_base_of<RLAgent, T>::value> UpdateExploration(
+    T *, int) {}
+
+}  // namespace internal
+
+// A Game whose players are known to be exactly First and Second, so that
+// Train calls their Step and UpdateExploration without virtual dispatch or
+// casts. It plays and learns exactly like a Game with the same players and
+// seed. For C++ only: Python and mixed players keep using Game.
+template<typename First, typename Second>
+class TypedGame : private Game {
+  static_assert(std::is_base_of<Agent, First>::value
+                    && std::is_base_of<Agent, Second>::value,
+                "Players must be agents");
+
+ public:
+  using Game::Reward;
+  TypedGame(const State &state, const First &first_player,
+            const Second &second_player)
+      : Game(state) {
+    SetFirstPlayer(first_player);
+    SetSecondPlayer(second_player);
+  }
+  using Game::GetAllStates;
+  std::shared_ptr<First> GetFirstPlayer() const {
+    return std::static_pointer_cast<First>(Game::GetFirstPlayer());
+  }
+  using Game::GetInitialState;
+  using Game::GetReward;
+  std::shared_ptr<Second> GetSecondPlayer() const {
+    return std::static_pointer_cast<Second>(Game::GetSecondPlayer());
+  }
+  using Game::GetState;
+  using Game::GetStateSpace;
+  using Game::IsTerminal;
+  using Game::Play;
+  using Game::PrintValues;
+  // The clone of the player must be exactly of the game's type, or calling
+  // its functions by that type would skip overrides.
+  void SetFirstPlayer(const First &first_player) {
+    Game::SetFirstPlayer(first_player);
+    first_player_ = Typed<First>(Game::GetFirstPlayer().get());
+  }
+  void SetSecondPlayer(const Second &second_player) {
+    Game::SetSecondPlayer(second_player);
+    second_player_ = Typed<Second>(Game::GetSecondPlayer().get());
+  }
+  using Game::SetSeed;
+  using Game::SetStopRatio;
+  using Game::SetTrajectoryLog;
+  using Game::SetVerbose;
+  std::pair<std::vector<double>, std::vector<double>> Train(
+      int episodes = 0, TrainStats *stats = nullptr) {
+    return TrainWith(first_player_, second_player_, episodes, stats);
+  }
+
+ private:
+  First *first_player_ = nullptr;
+  Second *second_player_ = nullptr;
+  template<typename T>
+  static T *Typed(Agent *player) {
+    if (typeid(*player) != typeid(T))
+      throw std::invalid_argument("Player is not exactly of its TypedGame "
+                                  "type");
+    return static_cast<T *>(player);
+  }
+};
+
+template<typename T>
+void Game::StepPlayer(T *player, AgentStats *stats) {
+  StatsScope stats_scope(stats);
+  NIM_RL_COUNT(steps);
+  NIM_RL_TIME(step_seconds);
+  internal::StepAgent(player, this, false);
+}
+
+template<typename First, typename Second>
+std::pair<std::vector<double>, std::vector<double>> Game::TrainWith(
+    First *first_player, Second *second_player, int episodes,
+    TrainStats *stats) {
+  NIM_RL_TRACE("Train", "episodes", episodes);
+  if (episodes < 0) throw std::invalid_argument("Episodes must >= 0");
+  if (!first_player || !second_player)
+    throw std::runtime_error("Agent should not be nullptr");
+  if (state_.IsEmpty()) throw std::runtime_error("State should not be empty");
+  if (stats) *stats = TrainStats();
+  ScopedTimer total_timer(stats ? &stats->total_seconds : nullptr);
+  AgentStats *first_stats = stats ? &stats->first_player : nullptr;
+  AgentStats *second_stats = stats ? &stats->second_player : nullptr;
+  RngScope rng_scope(is_seeded_ ? &rng_ : nullptr);
+  std::vector<double> optimal_action_ratios, mean_square_errors;
+  bool is_stopped = false;
+  {
+    ScopedTimer initialize_timer(stats ? &stats->initialize_seconds
+                                       : nullptr);
+    static const std::vector<State> kNoStates;
+    const std::vector<State> &all_states =
+        first_player->RequiresAllStates()
+            || second_player->RequiresAllStates()
+        ? GetAllStates() : kNoStates;
+    {
+      NIM_RL_TRACE("Initialize", "player", 1);
+      first_player->Initialize(all_states);
+    }
+    {
+      NIM_RL_TRACE("Initialize", "player", 2);
+      second_player->Initialize(all_states);
+    }
+  }
+  RLAgent *first_rl_agent = internal::AsRLAgent(first_player);
+  if (first_rl_agent) {
+    ScopedTimer checkpoint_timer(stats ? &stats->checkpoint_seconds
+                                       : nullptr);
+    NIM_RL_TRACE("Checkpoint", "episode", 0);
+    if (is_verbose_ && !first_rl_agent->IsDense())
+      std::cout << first_rl_agent->GetValues() << std::endl;
+    double optimal_action_ratio = first_rl_agent->OptimalActionsRatio();
+    optimal_action_ratios.push_back(optimal_action_ratio);
+    mean_square_errors.push_back(first_rl_agent->MinSquareError());
+    if (is_verbose_)
+      std::cout << "Epoch 1: " << optimal_action_ratio << std::endl;
+    is_stopped = optimal_action_ratio >= stop_ratio_;
+  }
+  episode_.is_evaluation = false;
+  Reset();
+  std::uint64_t num_steps = 0;
+  int i = 0;
+  for (; i < episodes && !is_stopped; ++i) {
+    NIM_RL_TRACE("Episode", "episode", i);
+    while (true) {
+      ++num_steps;
+      StepPlayer(first_player, first_stats);
+      if (IsTerminal()) {
+        StepPlayer(second_player, second_stats);
+        break;
+      }
+      ++num_steps;
+      StepPlayer(second_player, second_stats);
+      if (IsTerminal()) {
+        StepPlayer(first_player, first_stats);
+        break;
+      }
+    }
+    internal::UpdateExploration(first_player, i);
+    internal::UpdateExploration(second_player, i);
+    if ((i + 1) % kCheckPoint == 0) {
+      ScopedTimer checkpoint_timer(stats ? &stats->checkpoint_seconds
+                                         : nullptr);
+      NIM_RL_TRACE("Checkpoint", "episode", i + 1);
+      if (is_verbose_) std::cout << "Epoch " << i + 1 << ":";
+      if (first_rl_agent) {
+        if (is_verbose_ && !first_rl_agent->IsDense())
+          std::cout << first_rl_agent->GetValues() << std::endl;
+        double optimal_action_ratio = first_rl_agent->OptimalActionsRatio();
+        double mean_square_error = first_rl_agent->MinSquareError();
+        optimal_action_ratios.push_back(optimal_action_ratio);
+        mean_square_errors.push_back(mean_square_error);
+        if (is_verbose_) std::cout << optimal_action_ratio << std::endl;
+        is_stopped = optimal_action_ratio >= stop_ratio_;
+      }
+    }
+    Reset();
+  }
+  if (stats) {
+    stats->episodes = i;
+    stats->steps = num_steps;
+  }
+  if (trajectory_log_) trajectory_log_->Flush();
+  return std::make_pair(optimal_action_ratios, mean_square_errors);
+}
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_ENVIRONMENT_TYPED_GAME_H_
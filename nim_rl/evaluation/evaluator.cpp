@@ -0,0 +1,159 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/evaluation/evaluator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace nim_rl {
+
+constexpr PolicyTable::Rank PolicyTable::kIllegal;
+
+namespace {
+
+unsigned NumObjects(const State &state) {
+  unsigned num_objects = 0;
+  for (int pile_id = 0; pile_id != state.Size(); ++pile_id)
+    num_objects += state[pile_id];
+  return num_objects;
+}
+
+}  // namespace
+
+// Agents cache values and draw from the shared generator, so they are asked
+// one state at a time.
+PolicyTable::PolicyTable(const State &initial_state, Agent *agent,
+                         bool is_evaluation)
+    : state_range_(initial_state) {
+  if (!agent) throw std::invalid_argument("Agent should not be nullptr");
+  if (initial_state.IsEmpty())
+    throw std::invalid_argument("State should not be empty");
+  offsets_.reserve(state_range_.Size() + 1);
+  offsets_.push_back(0);
+  ActionProbs probs;
+  for (const auto &state : state_range_) {
+    if (!state.IsTerminal()) {
+      agent->GetActionProbs(state, is_evaluation, &probs);
+      for (const auto &action_prob : probs) {
+        const Action &action = action_prob.first;
+        children_.push_back(action.IsLegal(state)
+            ? state_range_.RankOf(state.Child(action))
+                - state_range_.GetBeginRank()
+            : kIllegal);
+        probs_.push_back(action_prob.second);
+      }
+    }
+    offsets_.push_back(children_.size());
+  }
+}
+
+Evaluator::Evaluator(int num_threads) {
+  if (num_threads != 1) pool_.reset(new ThreadPool(num_threads));
+}
+
+// Every move takes objects away, so the states are evaluated in order of
+// their number of objects, each after all of its children. The player to
+// move at the terminal state has lost, as has a player making an illegal
+// move.
+Evaluation Evaluator::Evaluate(const PolicyTable &first_player,
+                               const PolicyTable &second_player) {
+  const StateRange &state_range = first_player.GetStateRange();
+  if (state_range.Size() != second_player.GetStateRange().Size()
+      || state_range.Unrank(state_range.GetEndRank() - 1)
+          != second_player.GetStateRange().Unrank(
+              second_player.GetStateRange().GetEndRank() - 1))
+    throw std::invalid_argument("Policy tables cover different states");
+  using Rank = PolicyTable::Rank;
+  Evaluation evaluation;
+  evaluation.state_range = state_range;
+  evaluation.first_to_move.resize(state_range.Size());
+  evaluation.second_to_move.resize(state_range.Size());
+  // The states are sorted into levels by parts of the range in parallel,
+  // then the parts are joined in rank order.
+  std::vector<StateRange> parts =
+      state_range.Split(pool_ ? pool_->NumThreads() : 1);
+  std::vector<std::vector<std::vector<Rank>>> part_levels(parts.size());
+  auto sort_into_levels = [&](std::size_t part) {
+    auto &levels = part_levels[part];
+    for (auto iter = parts[part].begin(); iter != parts[part].end(); ++iter) {
+      unsigned num_objects = NumObjects(*iter);
+      if (num_objects >= levels.size()) levels.resize(num_objects + 1);
+      levels[num_objects].push_back(iter.GetRank()
+                                    - state_range.GetBeginRank());
+    }
+  };
+  if (pool_) {
+    for (std::size_t part = 0; part != parts.size(); ++part)
+      pool_->Submit([&, part] { sort_into_levels(part); });
+    pool_->Wait();
+  } else {
+    sort_into_levels(0);
+  }
+  std::vector<std::vector<Rank>> levels;
+  for (const auto &part : part_levels) {
+    if (part.size() > levels.size()) levels.resize(part.size());
+    for (std::size_t level = 0; level != part.size(); ++level)
+      levels[level].insert(levels[level].end(), part[level].begin(),
+                           part[level].end());
+  }
+  auto evaluate = [&](Rank index) {
+    double first_wins = 0.0, second_wins = 0.0;
+    for (auto move = first_player.MovesBegin(index);
+         move != first_player.MovesEnd(index); ++move) {
+      Rank child = first_player.GetChild(move);
+      if (child != PolicyTable::kIllegal)
+        first_wins += first_player.GetProb(move)
+            * evaluation.second_to_move[child];
+    }
+    for (auto move = second_player.MovesBegin(index);
+         move != second_player.MovesEnd(index); ++move) {
+      Rank child = second_player.GetChild(move);
+      second_wins += second_player.GetProb(move)
+          * (child == PolicyTable::kIllegal
+             ? 1.0 : evaluation.first_to_move[child]);
+    }
+    evaluation.first_to_move[index] = first_wins;
+    evaluation.second_to_move[index] = second_wins;
+  };
+  for (Rank index : levels.front()) evaluation.second_to_move[index] = 1.0;
+  for (auto level_iter = levels.begin() + 1; level_iter != levels.end();
+       ++level_iter) {
+    const auto &level = *level_iter;
+    if (!pool_) {
+      for (Rank index : level) evaluate(index);
+      continue;
+    }
+    std::size_t num_parts = std::min<std::size_t>(pool_->NumThreads(),
+                                                   level.size());
+    for (std::size_t part = 0; part != num_parts; ++part) {
+      pool_->Submit([&, part, num_parts] {
+        for (std::size_t i = level.size() * part / num_parts;
+             i != level.size() * (part + 1) / num_parts; ++i)
+          evaluate(level[i]);
+      });
+    }
+    pool_->Wait();
+  }
+  return evaluation;
+}
+
+Evaluation Evaluator::Evaluate(const State &initial_state,
+                               Agent *first_player, Agent *second_player,
+                               bool is_evaluation) {
+  return Evaluate(PolicyTable(initial_state, first_player, is_evaluation),
+                  PolicyTable(initial_state, second_player, is_evaluation));
+}
+
+}  // namespace nim_rl
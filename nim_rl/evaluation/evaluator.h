@@ -0,0 +1,91 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_EVALUATION_EVALUATOR_H_
+#define NIM_RL_EVALUATION_EVALUATOR_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "nim_rl/agent/agent.h"
+#include "nim_rl/state/state.h"
+#include "nim_rl/state/state_range.h"
+#include "nim_rl/thread/thread_pool.h"
+
+namespace nim_rl {
+
+// An agent's moves in every state of a StateRange, as the ranks of the
+// states they lead to with their probabilities, taken once from
+// Agent::GetActionProbs. States are indexed by rank minus the range's first
+// rank.
+class PolicyTable {
+ public:
+  using Rank = StateRange::Rank;
+  // The child of an illegal move, which loses the game.
+  static constexpr Rank kIllegal = static_cast<Rank>(-1);
+  PolicyTable(const State &initial_state, Agent *agent,
+              bool is_evaluation = true);
+  const StateRange &GetStateRange() const { return state_range_; }
+  // The moves of a state are those from MovesBegin(index) to
+  // MovesEnd(index).
+  std::size_t MovesBegin(Rank index) const { return offsets_[index]; }
+  std::size_t MovesEnd(Rank index) const { return offsets_[index + 1]; }
+  Rank GetChild(std::size_t move) const { return children_[move]; }
+  double GetProb(std::size_t move) const { return probs_[move]; }
+
+ private:
+  StateRange state_range_;
+  std::vector<std::size_t> offsets_;
+  std::vector<Rank> children_;
+  std::vector<double> probs_;
+};
+
+// The exact outcome of two policies playing each other, as Game::Play would
+// average it over infinitely many episodes: for every state, by index, the
+// probability that the first player wins when it is to move there and when
+// the second player is.
+struct Evaluation {
+  StateRange state_range;
+  std::vector<double> first_to_move;
+  std::vector<double> second_to_move;
+  // The probability that the first player wins from the state, moving first.
+  double WinProbability(const State &state) const {
+    return first_to_move[state_range.RankOf(state)
+        - state_range.GetBeginRank()];
+  }
+};
+
+// Evaluates two policy tables in one pass over the states from the fewest
+// objects up, where the states with the same number of objects are split
+// between the threads. The players are asked for their moves in canonical
+// states, so agents that break ties by pile order may be judged on other
+// tie breaks than they happen to make in Game::Play.
+class Evaluator {
+ public:
+  // Evaluates on the calling thread alone if num_threads is 1, or on a pool
+  // of num_threads threads, one per hardware thread if it is 0.
+  explicit Evaluator(int num_threads = 1);
+  Evaluation Evaluate(const PolicyTable &first_player,
+                      const PolicyTable &second_player);
+  Evaluation Evaluate(const State &initial_state, Agent *first_player,
+                      Agent *second_player, bool is_evaluation = true);
+
+ private:
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_EVALUATION_EVALUATOR_H_
@@ -17,7 +17,7 @@
 
 #include <algorithm>
 #include <memory>
-#include <random>
+#include <stdexcept>
 #include <vector>
 
 #include "nim_rl/action/action.h"
@@ -36,6 +36,14 @@ class Exploration {
   virtual std::shared_ptr<Exploration> Clone() const = 0;
   virtual Action Explore(const std::vector<Action> &legal_actions,
                          const std::vector<Action> &greedy_actions) = 0;
+  // Adds the distribution Explore draws from to probs. Throws
+  // std::logic_error unless the exploration overrides it.
+  virtual void GetActionProbs(const std::vector<Action> &/*legal_actions*/,
+                              const std::vector<Action> &/*greedy_actions*/,
+                              ActionProbs * /*probs*/) const {
+    throw std::logic_error("Exploration does not expose its action "
+                           "probabilities.");
+  }
   virtual void Update(int episode) = 0;
 };
 
@@ -54,8 +62,14 @@ class EpsilonGreedy : public Exploration {
   }
   Action Explore(const std::vector<Action> &legal_actions,
                  const std::vector<Action> &greedy_actions) override {
-    return (dist_epsilon_(rng_) < epsilon_) ? SampleAction(legal_actions)
-                                            : SampleAction(greedy_actions);
+    return RandomEngine().Bernoulli(epsilon_) ? SampleAction(legal_actions)
+                                              : SampleAction(greedy_actions);
+  }
+  void GetActionProbs(const std::vector<Action> &legal_actions,
+                      const std::vector<Action> &greedy_actions,
+                      ActionProbs *probs) const override {
+    AddUniformProbs(legal_actions, epsilon_, probs);
+    AddUniformProbs(greedy_actions, 1.0 - epsilon_, probs);
   }
   double GetEpsilon() const { return epsilon_; }
   double GetEpsilonDecayFactor() const { return epsilon_decay_factor_; }
@@ -74,8 +88,6 @@ class EpsilonGreedy : public Exploration {
   double epsilon_;
   double epsilon_decay_factor_;
   double min_epsilon_;
-  std::uniform_real_distribution<> dist_epsilon_{0, 1};
-  std::mt19937 rng_{std::random_device{}()};
 };
 
 }  // namespace nim_rl
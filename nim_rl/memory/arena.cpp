@@ -0,0 +1,63 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/memory/arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace nim_rl {
+
+void *Arena::Allocate(std::size_t size, std::size_t alignment) {
+  if (!blocks_.empty()) {
+    auto base = reinterpret_cast<std::uintptr_t>(blocks_.back().data.get());
+    std::size_t offset =
+        (base + offset_ + alignment - 1) / alignment * alignment - base;
+    if (offset + size <= blocks_.back().size) {
+      offset_ = offset + size;
+      used_ += size;
+      return blocks_.back().data.get() + offset;
+    }
+  }
+  AddBlock(size + alignment);
+  return Allocate(size, alignment);
+}
+
+std::size_t Arena::GetCapacity() const {
+  std::size_t capacity = 0;
+  for (const auto &block : blocks_) capacity += block.size;
+  return capacity;
+}
+
+std::size_t Arena::GetUsed() const { return used_; }
+
+void Arena::Reset() {
+  if (blocks_.size() > 1) {
+    std::size_t capacity = GetCapacity();
+    blocks_.clear();
+    AddBlock(capacity);
+  }
+  offset_ = 0;
+  used_ = 0;
+}
+
+void Arena::AddBlock(std::size_t min_size) {
+  std::size_t size = std::max(min_size, block_size_);
+  if (!blocks_.empty()) size = std::max(size, 2 * blocks_.back().size);
+  NIM_RL_COUNT(heap_allocations);
+  blocks_.push_back({std::unique_ptr<char[]>(new char[size]), size});
+  offset_ = 0;
+}
+
+}  // namespace nim_rl
@@ -0,0 +1,107 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_MEMORY_ARENA_H_
+#define NIM_RL_MEMORY_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "nim_rl/stats/stats.h"
+
+namespace nim_rl {
+
+constexpr std::size_t kDefaultArenaBlockSize = 64 * 1024;
+
+// Monotonic allocator whose memory is released all at once by Reset. After
+// the first few episodes the arena settles on a single block that is large
+// enough for a whole episode, so later episodes never reach the global
+// allocator.
+class Arena {
+ public:
+  explicit Arena(std::size_t block_size = kDefaultArenaBlockSize)
+      : block_size_(block_size) {}
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  ~Arena() = default;
+  void *Allocate(std::size_t size, std::size_t alignment);
+  std::size_t GetCapacity() const;
+  std::size_t GetUsed() const;
+  void Reset();
+
+ private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    std::size_t size;
+  };
+  std::size_t block_size_;
+  std::size_t offset_ = 0;
+  std::size_t used_ = 0;
+  std::vector<Block> blocks_;
+  void AddBlock(std::size_t min_size);
+};
+
+// STL allocator backed by an Arena, or by the global allocator when no arena
+// is bound. Copies of a container never share its arena; only moves do.
+template<typename T>
+class ArenaAllocator {
+  template<typename U> friend class ArenaAllocator;
+
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  ArenaAllocator() = default;
+  explicit ArenaAllocator(Arena *arena) : arena_(arena) {}
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.arena_) {}
+  T *allocate(std::size_t n) {
+    NIM_RL_COUNT(allocations);
+    if (arena_)
+      return static_cast<T *>(arena_->Allocate(n * sizeof(T), alignof(T)));
+    NIM_RL_COUNT(heap_allocations);
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+  void deallocate(T *p, std::size_t /*n*/) {
+    if (!arena_) ::operator delete(p);
+  }
+  Arena *GetArena() const { return arena_; }
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+
+ private:
+  Arena *arena_ = nullptr;
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T> &lhs, const ArenaAllocator<U> &rhs) {
+  return lhs.GetArena() == rhs.GetArena();
+}
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &lhs, const ArenaAllocator<U> &rhs) {
+  return !(lhs == rhs);
+}
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_MEMORY_ARENA_H_
@@ -0,0 +1,115 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/memory/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <system_error>
+
+namespace nim_rl {
+
+namespace {
+
+[[noreturn]] void ThrowSystemError(const std::string &what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Maps size bytes of fd at an address aligned to kHugePageSize by reserving
+// one huge page more than needed and trimming the slack on both sides. The
+// mapping ends on the page after size, which need not be a page multiple.
+char *MapAligned(int fd, std::size_t size, int prot, int flags) {
+  void *reserved = mmap(nullptr, size + kHugePageSize, PROT_NONE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (reserved == MAP_FAILED) return nullptr;
+  auto base = reinterpret_cast<std::uintptr_t>(reserved);
+  auto aligned = (base + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  void *data = mmap(reinterpret_cast<void *>(aligned), size, prot,
+                    flags | MAP_FIXED, fd, 0);
+  if (data == MAP_FAILED) {
+    munmap(reserved, size + kHugePageSize);
+    return nullptr;
+  }
+  if (aligned != base) munmap(reserved, aligned - base);
+  auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  std::size_t mapped_size = (size + page_size - 1) / page_size * page_size;
+  std::size_t tail = base + size + kHugePageSize - aligned - mapped_size;
+  if (tail) munmap(reinterpret_cast<char *>(aligned) + mapped_size, tail);
+  return static_cast<char *>(data);
+}
+
+}  // namespace
+
+MappedFile::MappedFile(const std::string &path, std::size_t min_size,
+                       Mode mode) : path_(path), mode_(mode) {
+  bool is_read_only = mode != Mode::kReadWrite;
+  fd_ = open(path.c_str(), is_read_only ? O_RDONLY : O_RDWR);
+  if (fd_ < 0 && errno == ENOENT && !is_read_only) {
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    is_created_ = true;
+  }
+  if (fd_ < 0) ThrowSystemError("Cannot open " + path);
+  struct stat status;
+  if (fstat(fd_, &status)) {
+    close(fd_);
+    ThrowSystemError("Cannot stat " + path);
+  }
+  size_ = static_cast<std::size_t>(status.st_size);
+  // A file that was there before may belong to something else, so only the
+  // one created here is resized.
+  if (!is_created_) {
+    if (size_ < min_size) {
+      close(fd_);
+      throw std::runtime_error(path + " is truncated.");
+    }
+  } else {
+    size_ = (min_size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    if (ftruncate(fd_, static_cast<off_t>(size_))) {
+      close(fd_);
+      ThrowSystemError("Cannot resize " + path);
+    }
+  }
+  if (!size_) return;
+  data_ = MapAligned(fd_, size_,
+                     mode == Mode::kReadOnly ? PROT_READ
+                                             : PROT_READ | PROT_WRITE,
+                     mode == Mode::kCopyOnWrite ? MAP_PRIVATE : MAP_SHARED);
+  if (!data_) {
+    close(fd_);
+    ThrowSystemError("Cannot map " + path);
+  }
+#ifdef MADV_HUGEPAGE
+  madvise(data_, size_, MADV_HUGEPAGE);
+#endif
+  // Values are looked up by state rank, which jumps around the file.
+  madvise(data_, size_, MADV_RANDOM);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) munmap(data_, size_);
+  if (fd_ >= 0) close(fd_);
+}
+
+void MappedFile::Flush() {
+  if (data_ && mode_ == Mode::kReadWrite && msync(data_, size_, MS_SYNC))
+    ThrowSystemError("Cannot flush " + path_);
+}
+
+}  // namespace nim_rl
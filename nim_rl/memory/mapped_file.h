@@ -0,0 +1,62 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_MEMORY_MAPPED_FILE_H_
+#define NIM_RL_MEMORY_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace nim_rl {
+
+constexpr std::size_t kHugePageSize = 2 * 1024 * 1024;
+
+// A file mapped shared into memory, so writes reach the file and pages are
+// read on demand. The mapping address and the size of a created file are
+// multiples of kHugePageSize, which lets the kernel back the mapping with huge
+// pages where the file system supports it.
+//
+// A copy-on-write mapping is private instead: it may be written, but the
+// written pages are copied into memory and never reach the file.
+class MappedFile {
+ public:
+  enum class Mode { kReadOnly, kReadWrite, kCopyOnWrite };
+  // Opens the file at path, which must hold min_size bytes. In read-write
+  // mode the file is created if it does not exist, with min_size zero bytes
+  // rounded up to kHugePageSize. An existing file is never resized.
+  MappedFile(const std::string &path, std::size_t min_size,
+             Mode mode = Mode::kReadWrite);
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+  void Flush();
+  char *GetData() const { return data_; }
+  Mode GetMode() const { return mode_; }
+  const std::string &GetPath() const { return path_; }
+  std::size_t GetSize() const { return size_; }
+  // Whether the file did not exist before this mapping.
+  bool IsCreated() const { return is_created_; }
+
+ private:
+  std::string path_;
+  Mode mode_;
+  char *data_ = nullptr;
+  std::size_t size_ = 0;
+  int fd_ = -1;
+  bool is_created_ = false;
+};
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_MEMORY_MAPPED_FILE_H_
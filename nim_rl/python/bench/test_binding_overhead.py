@@ -0,0 +1,275 @@
+# Copyright 2020 Zhou Zikang. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Measures what crossing the C++/Python boundary costs.
+
+Three groups of benchmarks, run with pytest-benchmark:
+
+    pytest nim_rl/python/bench --benchmark-group-by=group
+
+"call" times single calls of the bound methods from Python, "cpp_agent"
+drives C++ agents step by step from Python, and "py_agent" lets Game.train
+drive agents and explorations whose methods are written in Python, through
+the PyAgent and PyExploration trampolines. The training benchmarks also
+report the seconds per move in extra_info, which is what to compare against
+the same agent implemented in C++ ("py_agent" keeps a C++ baseline for each
+Python agent).
+"""
+
+import pytest
+
+from pynim import *
+
+STATE = [10, 10, 10]
+EPISODES = 200
+ROUNDS = 5
+
+
+class PyRandomAgent(Agent):
+    """Crosses the boundary once per step, through policy."""
+
+    def __init__(self):
+        Agent.__init__(self)
+
+    def clone(self):
+        cloned = PyRandomAgent.__new__(PyRandomAgent)
+        Agent.__init__(cloned, self)
+        return cloned
+
+    def policy(self, state, is_evaluation):
+        return sample_action(state)
+
+
+class PyQLearningAgent(QLearningAgent):
+    """A C++ agent with only policy_impl in Python, the hook DQN uses."""
+
+    def __init__(self):
+        QLearningAgent.__init__(self)
+
+    def clone(self):
+        cloned = PyQLearningAgent.__new__(PyQLearningAgent)
+        QLearningAgent.__init__(cloned, self)
+        return cloned
+
+    def policy_impl(self, legal_actions, greedy_actions):
+        return sample_action(greedy_actions)
+
+
+class PyGreedy(Exploration):
+    """Crosses the boundary once per exploring step, through explore."""
+
+    def __init__(self):
+        Exploration.__init__(self)
+
+    def clone(self):
+        cloned = PyGreedy.__new__(PyGreedy)
+        Exploration.__init__(cloned, self)
+        return cloned
+
+    def explore(self, legal_actions, greedy_actions):
+        return sample_action(greedy_actions)
+
+    def update(self, episode):
+        pass
+
+
+def make_game(agent):
+    game = Game(State(STATE))
+    game.set_seed(0)
+    game.set_verbose(False)
+    game.set_first_player(agent)
+    game.set_second_player(agent)
+    return game
+
+
+def train(benchmark, game, episodes=EPISODES, rounds=ROUNDS):
+    """Benchmarks game.train_with_stats and reports the time per move."""
+    stats = []
+    benchmark.pedantic(
+        lambda: stats.append(game.train_with_stats(episodes)[2]),
+        rounds=rounds, iterations=1)
+    steps = stats[-1].steps
+    benchmark.extra_info["steps"] = steps
+    benchmark.extra_info["seconds_per_step"] = \
+        benchmark.stats.stats.mean / max(steps, 1)
+
+
+@pytest.fixture
+def state():
+    return State(STATE)
+
+
+@pytest.fixture
+def trained_agent():
+    agent = QLearningAgent()
+    game = make_game(agent)
+    game.train(1000)
+    return game.get_first_player()
+
+
+@pytest.mark.benchmark(group="call")
+def test_state_init(benchmark):
+    benchmark(State, STATE)
+
+
+@pytest.mark.benchmark(group="call")
+def test_state_legal_actions(benchmark, state):
+    benchmark(state.legal_actions)
+
+
+@pytest.mark.benchmark(group="call")
+def test_state_child(benchmark, state):
+    benchmark(state.child, Action(0, 1))
+
+
+@pytest.mark.benchmark(group="call")
+def test_state_hash(benchmark, state):
+    benchmark(hash, state)
+
+
+@pytest.mark.benchmark(group="call")
+def test_sample_action(benchmark, state):
+    benchmark(sample_action, state)
+
+
+@pytest.mark.benchmark(group="call")
+def test_agent_init(benchmark):
+    # Each new agent builds a SmartPtr holder, which takes a reference.
+    benchmark(QLearningAgent)
+
+
+@pytest.mark.benchmark(group="call")
+def test_set_player(benchmark):
+    game = Game(State(STATE))
+    agent = QLearningAgent()
+    benchmark(game.set_first_player, agent)
+
+
+@pytest.mark.benchmark(group="call")
+def test_set_py_player(benchmark):
+    # Clones through the Python clone method.
+    game = Game(State(STATE))
+    agent = PyRandomAgent()
+    benchmark(game.set_first_player, agent)
+
+
+@pytest.mark.benchmark(group="call")
+def test_explore(benchmark, state):
+    exploration = EpsilonGreedy()
+    legal_actions = state.legal_actions()
+    benchmark(exploration.explore, legal_actions, legal_actions[:1])
+
+
+@pytest.mark.benchmark(group="call")
+def test_py_explore(benchmark, state):
+    exploration = PyGreedy()
+    legal_actions = state.legal_actions()
+    benchmark(exploration.explore, legal_actions, legal_actions[:1])
+
+
+@pytest.mark.benchmark(group="call")
+def test_policy(benchmark, trained_agent, state):
+    benchmark(trained_agent.policy, state, False)
+
+
+@pytest.mark.benchmark(group="call")
+def test_get_value(benchmark, trained_agent, state):
+    benchmark(trained_agent.get_value, state)
+
+
+@pytest.mark.benchmark(group="call")
+def test_update(benchmark, trained_agent, state):
+    child = state.child(Action(0, 1))
+    benchmark(trained_agent.update, state, child, TIE_REWARD)
+
+
+@pytest.mark.benchmark(group="call")
+def test_game_step(benchmark):
+    game = Game(State(STATE))
+    action = Action(0, 1)
+
+    def step():
+        game.set_state(State(STATE))
+        game.step(action)
+
+    benchmark(step)
+
+
+@pytest.mark.benchmark(group="cpp_agent")
+def test_cpp_agent_steps_from_python(benchmark):
+    game = make_game(QLearningAgent())
+    game.train(1000)
+    players = [game.get_first_player(), game.get_second_player()]
+
+    def episode():
+        game.reset()
+        player = 0
+        while not game.is_terminal():
+            players[player].step(game, False)
+            player = 1 - player
+        players[player].step(game, False)
+
+    benchmark(episode)
+
+
+@pytest.mark.benchmark(group="cpp_agent")
+def test_cpp_agent_episode_from_python(benchmark):
+    # The same episode without leaving C++, for comparison.
+    game = make_game(QLearningAgent())
+    game.train(1000)
+    benchmark(game.train, 1)
+
+
+@pytest.mark.benchmark(group="py_agent")
+def test_train_random_agent(benchmark):
+    train(benchmark, make_game(RandomAgent()))
+
+
+@pytest.mark.benchmark(group="py_agent")
+def test_train_py_random_agent(benchmark):
+    train(benchmark, make_game(PyRandomAgent()))
+
+
+@pytest.mark.benchmark(group="py_agent")
+def test_train_q_learning_agent(benchmark):
+    train(benchmark, make_game(QLearningAgent()))
+
+
+@pytest.mark.benchmark(group="py_agent")
+def test_train_py_q_learning_agent(benchmark):
+    train(benchmark, make_game(PyQLearningAgent()))
+
+
+@pytest.mark.benchmark(group="py_agent")
+def test_train_on_policy_mc_agent(benchmark):
+    train(benchmark, make_game(OnPolicyMonteCarloAgent(1.0, EpsilonGreedy())))
+
+
+@pytest.mark.benchmark(group="py_agent")
+def test_train_on_policy_mc_agent_py_exploration(benchmark):
+    train(benchmark, make_game(OnPolicyMonteCarloAgent(1.0, PyGreedy())))
+
+
+@pytest.mark.benchmark(group="py_agent")
+def test_train_dqn(benchmark):
+    pytest.importorskip("tensorflow")
+    pytest.importorskip("pydot")
+    from nim_rl.python.agent.dqn import DQN
+    dqn = DQN(min_buffer_size_to_learn=32)
+    game = Game(State([3, 3]))
+    game.set_seed(0)
+    game.set_verbose(False)
+    game.set_first_player(dqn)
+    game.set_second_player(dqn)
+    train(benchmark, game, episodes=10, rounds=1)
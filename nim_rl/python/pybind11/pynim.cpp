@@ -14,6 +14,7 @@
 
 #include "nim_rl/action/action.h"
 #include "nim_rl/agent/agent.h"
+#include "nim_rl/agent/agent_file.h"
 #include "nim_rl/agent/dp_agent.h"
 #include "nim_rl/agent/human_agent.h"
 #include "nim_rl/agent/monte_carlo_agent.h"
@@ -22,9 +23,17 @@
 #include "nim_rl/agent/random_agent.h"
 #include "nim_rl/agent/rl_agent.h"
 #include "nim_rl/agent/td_agent.h"
+#include "nim_rl/agent/value_table.h"
 #include "nim_rl/environment/game.h"
+#include "nim_rl/environment/offline_trainer.h"
+#include "nim_rl/environment/trajectory_log.h"
+#include "nim_rl/evaluation/evaluator.h"
 #include "nim_rl/exploration/exploration.h"
 #include "nim_rl/state/state.h"
+#include "nim_rl/state/state_batch.h"
+#include "nim_rl/state/state_range.h"
+#include "nim_rl/stats/stats.h"
+#include "nim_rl/stats/tracer.h"
 #include "pybind11/include/pybind11/operators.h"
 #include "pybind11/include/pybind11/pybind11.h"
 #include "pybind11/include/pybind11/stl.h"
@@ -56,6 +65,7 @@ using Reward = Agent::Reward;
 using Transitions = std::unordered_map<RLAgent::StateAction,
                                        std::vector<RLAgent::StateProb>>;
 using Values = RLAgent::Values;
+using Hyperparameters = RLAgent::Hyperparameters;
 
 namespace py = ::pybind11;
 
@@ -131,14 +141,44 @@ class PyRLAgent : public PyAgent<RLAgentBase> {
     auto ptr = obj.cast<PyRLAgent *>();
     return std::shared_ptr<Agent>(keep_python_state_alive, ptr);
   }
+  void CompactValues(const State &initial_state, Precision precision,
+                     std::size_t cache_capacity) override {
+    PYBIND11_OVERLOAD_NAME(void, RLAgentBase, "compact_values", CompactValues,
+                           initial_state, precision, cache_capacity);
+  }
+  void FlushValues() override {
+    PYBIND11_OVERLOAD_NAME(void, RLAgentBase, "flush_values", FlushValues,);
+  }
+  Reward GetValue(const State &state) const override {
+    PYBIND11_OVERLOAD_NAME(Reward, RLAgentBase, "get_value", GetValue, state);
+  }
+  Hyperparameters GetHyperparameters() const override {
+    PYBIND11_OVERLOAD_NAME(Hyperparameters, RLAgentBase, "get_hyperparameters",
+                           GetHyperparameters,);
+  }
+  std::string GetType() const override {
+    PYBIND11_OVERLOAD_NAME(std::string, RLAgentBase, "get_type", GetType,);
+  }
   Values GetValues() const override {
     PYBIND11_OVERLOAD_NAME(Values, RLAgentBase, "get_values", GetValues,);
   }
+  void MapValues(const std::string &path, const State &initial_state,
+                 Precision precision, std::size_t cache_capacity) override {
+    PYBIND11_OVERLOAD_NAME(void, RLAgentBase, "map_values", MapValues, path,
+                           initial_state, precision, cache_capacity);
+  }
   Action PolicyImpl(const std::vector<Action> &legal_actions,
                     const std::vector<Action> &greedy_actions) override {
     PYBIND11_OVERLOAD_PURE_NAME(Action, RLAgentBase, "policy_impl", PolicyImpl,
                                 legal_actions, greedy_actions);
   }
+  void SetHyperparameters(const Hyperparameters &hyperparameters) override {
+    PYBIND11_OVERLOAD_NAME(void, RLAgentBase, "set_hyperparameters",
+                           SetHyperparameters, hyperparameters);
+  }
+  void SetLazy(bool is_lazy) override {
+    PYBIND11_OVERLOAD_NAME(void, RLAgentBase, "set_lazy", SetLazy, is_lazy);
+  }
   void SetValues(const Values &values) override {
     PYBIND11_OVERLOAD_NAME(void, RLAgentBase, "set_values", SetValues, values);
   }
@@ -175,7 +215,7 @@ class PyDoubleLearningAgent : public PyTDAgent<DoubleLearningAgentBase> {
   using PyTDAgent<DoubleLearningAgentBase>::PyTDAgent;
   ~PyDoubleLearningAgent() override = default;
   void DoUpdate(const State &update_state, const State &current_state,
-                Reward reward, Values *values) override {
+                Reward reward, ValueTable *values) override {
     PYBIND11_OVERLOAD_PURE_NAME(void, DoubleLearningAgentBase, "do_update",
                                 DoUpdate, update_state, current_state,
                                 reward, values);
@@ -214,13 +254,16 @@ PYBIND11_MODULE(pynim, m) {
       .def(py::init<std::vector<unsigned>>())
       .def("apply_action", &State::ApplyAction)
       .def("child", &State::Child)
-      .def("children", &State::Children)
+      .def("children", py::overload_cast<>(&State::Children, py::const_))
       .def("clear", &State::Clear)
+      .def("count_states", &State::CountStates)
       .def("get_all_states", &State::GetAllStates)
       .def(hash(py::self))
       .def("is_empty", &State::IsEmpty)
       .def("is_terminal", &State::IsTerminal)
-      .def("legal_actions", &State::LegalActions)
+      .def("legal_actions",
+           py::overload_cast<>(&State::LegalActions, py::const_))
+      .def("num_legal_actions", &State::NumLegalActions)
       .def("nim_sum", &State::NimSum)
       .def("out_of_range", &State::OutOfRange)
       .def("parent", &State::Parent)
@@ -238,6 +281,56 @@ PYBIND11_MODULE(pynim, m) {
 
   m.def("swap", py::overload_cast<State &, State &>(&swap));
 
+  py::class_<StateRange>(m, "StateRange").def(py::init<>())
+      .def(py::init<const State &>())
+      .def("get_begin_rank", &StateRange::GetBeginRank)
+      .def("get_end_rank", &StateRange::GetEndRank)
+      .def("rank_of", &StateRange::RankOf, py::arg("state"))
+      .def("split", &StateRange::Split, py::arg("num_parts"))
+      .def("unrank", &StateRange::Unrank, py::arg("rank"))
+      .def("__iter__",
+           [](const StateRange &states) {
+             return py::make_iterator(states.begin(), states.end());
+           },
+           py::keep_alive<0, 1>())
+      .def("__len__", &StateRange::Size);
+
+  py::class_<StateBatch>(m, "StateBatch").def(py::init<>())
+      .def(py::init<StateBatch::size_type>())
+      .def(py::init<const std::vector<State> &>())
+      .def("canonicalize", &StateBatch::Canonicalize)
+      .def("child",
+           [](const StateBatch &states, const std::vector<Action> &actions) {
+             StateBatch children;
+             states.Child(actions, &children);
+             return children;
+           },
+           py::arg("actions"))
+      .def("clear", &StateBatch::Clear)
+      .def("get", &StateBatch::Get, py::arg("index"))
+      .def("hash",
+           [](const StateBatch &states) {
+             std::vector<std::size_t> hashes;
+             states.Hash(&hashes);
+             return hashes;
+           })
+      .def("is_terminal",
+           [](const StateBatch &states) {
+             std::vector<unsigned char> is_terminal;
+             states.IsTerminal(&is_terminal);
+             return std::vector<bool>(is_terminal.begin(), is_terminal.end());
+           })
+      .def("nim_sum",
+           [](const StateBatch &states) {
+             std::vector<unsigned> nim_sums;
+             states.NimSum(&nim_sums);
+             return nim_sums;
+           })
+      .def("num_piles", &StateBatch::NumPiles)
+      .def("push_back", &StateBatch::PushBack, py::arg("state"))
+      .def("reserve", &StateBatch::Reserve, py::arg("capacity"))
+      .def("__len__", &StateBatch::Size);
+
   m.attr("CHECK_POINT") = py::int_(nim_rl::kCheckPoint);
   m.attr("WIN_REWARD") = py::float_(nim_rl::kWinReward);
   m.attr("TIE_REWARD") = py::float_(nim_rl::kTieReward);
@@ -255,7 +348,10 @@ PYBIND11_MODULE(pynim, m) {
       .def("get_reward", &Game::GetReward)
       .def("get_second_player", &Game::GetSecondPlayer)
       .def("get_state", &Game::GetState)
+      .def("get_state_range", &Game::GetStateRange)
+      .def("get_trajectory_log", &Game::GetTrajectoryLog)
       .def("is_terminal", &Game::IsTerminal)
+      .def("is_verbose", &Game::IsVerbose)
       .def("play", &Game::Play, py::arg("episodes") = 1)
       .def("print_values", &Game::PrintValues)
       .def("render", &Game::Render)
@@ -263,13 +359,101 @@ PYBIND11_MODULE(pynim, m) {
       .def("set_first_player", &Game::SetFirstPlayer)
       .def("set_initial_state", &Game::SetInitialState<const State &>)
       .def("set_reward", &Game::SetReward)
+      .def("set_seed", &Game::SetSeed, py::arg("seed"))
       .def("set_second_player", &Game::SetSecondPlayer)
       .def("set_state", &Game::SetState<const State &>)
+      .def("set_stop_ratio", &Game::SetStopRatio, py::arg("ratio"))
+      .def("set_trajectory_log", &Game::SetTrajectoryLog, py::arg("log"))
+      .def("set_verbose", &Game::SetVerbose, py::arg("is_verbose"))
       .def("step", &Game::Step)
-      .def("train", &Game::Train, py::arg("episodes") = 0);
+      .def("train",
+           [](Game &game, int episodes) { return game.Train(episodes); },
+           py::arg("episodes") = 0)
+      .def("train_with_stats",
+           [](Game &game, int episodes) {
+             TrainStats stats;
+             auto curves = game.Train(episodes, &stats);
+             return py::make_tuple(curves.first, curves.second, stats);
+           },
+           py::arg("episodes") = 0);
+
+  py::class_<AgentStats>(m, "AgentStats")
+      .def_readonly("steps", &AgentStats::steps)
+      .def_readonly("updates", &AgentStats::updates)
+      .def_readonly("lookups", &AgentStats::lookups)
+      .def_readonly("inserts", &AgentStats::inserts)
+      .def_readonly("probes", &AgentStats::probes)
+      .def_readonly("allocations", &AgentStats::allocations)
+      .def_readonly("heap_allocations", &AgentStats::heap_allocations)
+      .def_readonly("step_seconds", &AgentStats::step_seconds)
+      .def_readonly("policy_seconds", &AgentStats::policy_seconds)
+      .def_readonly("update_seconds", &AgentStats::update_seconds);
+
+  py::class_<TrainStats>(m, "TrainStats")
+      .def_readonly("first_player", &TrainStats::first_player)
+      .def_readonly("second_player", &TrainStats::second_player)
+      .def_readonly("episodes", &TrainStats::episodes)
+      .def_readonly("steps", &TrainStats::steps)
+      .def_readonly("initialize_seconds", &TrainStats::initialize_seconds)
+      .def_readonly("checkpoint_seconds", &TrainStats::checkpoint_seconds)
+      .def_readonly("total_seconds", &TrainStats::total_seconds);
 
   m.def("swap", py::overload_cast<Game &, Game &>(&swap));
 
+  py::class_<Episode>(m, "Episode")
+      .def(py::init<>())
+      .def("states", &Episode::States)
+      .def_readwrite("initial_state", &Episode::initial_state)
+      .def_readwrite("actions", &Episode::actions)
+      .def_readwrite("rewards", &Episode::rewards)
+      .def_readwrite("is_evaluation", &Episode::is_evaluation);
+
+  py::class_<TrajectoryWriter, std::shared_ptr<TrajectoryWriter>>(
+      m, "TrajectoryWriter")
+      .def(py::init<const std::string &>(), py::arg("path"))
+      .def("append", &TrajectoryWriter::Append, py::arg("episode"))
+      .def("close", &TrajectoryWriter::Close)
+      .def("flush", &TrajectoryWriter::Flush)
+      .def("get_path", &TrajectoryWriter::GetPath);
+
+  py::class_<TrajectoryReader>(m, "TrajectoryReader")
+      .def(py::init<const std::string &>(), py::arg("path"))
+      .def("next",
+           [](TrajectoryReader &reader) -> py::object {
+             Episode episode;
+             if (!reader.Next(&episode)) return py::none();
+             return py::cast(std::move(episode));
+           })
+      .def("rewind", &TrajectoryReader::Rewind);
+
+  py::class_<OfflineTrainer>(m, "OfflineTrainer")
+      .def(py::init<const std::string &>(), py::arg("path"))
+      .def("train", &OfflineTrainer::Train, py::arg("agent"),
+           py::arg("epochs") = 1, py::arg("include_evaluation") = false);
+
+  py::class_<PolicyTable>(m, "PolicyTable")
+      .def(py::init<const State &, Agent *, bool>(), py::arg("initial_state"),
+           py::arg("agent"), py::arg("is_evaluation") = true)
+      .def("get_state_range", &PolicyTable::GetStateRange);
+
+  py::class_<Evaluation>(m, "Evaluation")
+      .def_readonly("state_range", &Evaluation::state_range)
+      .def_readonly("first_to_move", &Evaluation::first_to_move)
+      .def_readonly("second_to_move", &Evaluation::second_to_move)
+      .def("win_probability", &Evaluation::WinProbability, py::arg("state"));
+
+  py::class_<Evaluator>(m, "Evaluator")
+      .def(py::init<int>(), py::arg("num_threads") = 1)
+      .def("evaluate",
+           py::overload_cast<const PolicyTable &, const PolicyTable &>(
+               &Evaluator::Evaluate),
+           py::arg("first_player"), py::arg("second_player"))
+      .def("evaluate",
+           py::overload_cast<const State &, Agent *, Agent *, bool>(
+               &Evaluator::Evaluate),
+           py::arg("initial_state"), py::arg("first_player"),
+           py::arg("second_player"), py::arg("is_evaluation") = true);
+
   py::class_<Exploration, PyExploration<>, std::shared_ptr<Exploration>>(
       m, "Exploration")
       .def(py::init<>())
@@ -299,20 +483,91 @@ PYBIND11_MODULE(pynim, m) {
            py::arg("min_epsilon"))
       .def("update", &EpsilonGreedy::Update);
 
-  m.def("sample_action", &SampleAction, py::arg("actions"));
-  m.def("sample_state", &SampleState, py::arg("states"));
+  m.def("seed_random_engine", &SeedRandomEngine, py::arg("seed"));
+  m.def("start_trace", &StartTrace, py::arg("path"),
+        py::arg("buffer_size") = kDefaultTraceBufferSize);
+  m.def("stop_trace", &StopTrace);
+  m.def("sample_action",
+        py::overload_cast<const std::vector<Action> &>(&SampleAction),
+        py::arg("actions"));
+  m.def("sample_action", py::overload_cast<const State &>(&SampleAction),
+        py::arg("state"));
+  m.def("sample_state",
+        py::overload_cast<const std::vector<State> &>(&SampleState),
+        py::arg("states"));
+  m.def("sample_state", py::overload_cast<const StateRange &>(&SampleState),
+        py::arg("states"));
+
+  py::enum_<Precision>(m, "Precision")
+      .value("FLOAT64", Precision::kFloat64)
+      .value("FLOAT32", Precision::kFloat32)
+      .value("FLOAT16", Precision::kFloat16)
+      .value("INT8", Precision::kInt8);
+
+  py::class_<ValueTable>(m, "ValueTable")
+      .def(py::init<>())
+      .def(py::init<bool>(), py::arg("is_lazy"))
+      .def_static("initial_value", &ValueTable::InitialValue, py::arg("state"))
+      .def("clear", &ValueTable::Clear)
+      .def("compact", &ValueTable::Compact, py::arg("initial_state"),
+           py::arg("precision"),
+           py::arg("cache_capacity") = kDefaultValueCacheCapacity)
+      .def("flush", &ValueTable::Flush)
+      .def("get", &ValueTable::Get, py::arg("state"))
+      .def("get_path", &ValueTable::GetPath)
+      .def("get_precision", &ValueTable::GetPrecision)
+      .def("get_state_range", &ValueTable::GetStateRange)
+      .def("get_values", &ValueTable::GetValues)
+      .def("is_dense", &ValueTable::IsDense)
+      .def("is_lazy", &ValueTable::IsLazy)
+      .def("is_mapped", &ValueTable::IsMapped)
+      .def("map", &ValueTable::Map, py::arg("path"), py::arg("initial_state"),
+           py::arg("precision") = Precision::kFloat64,
+           py::arg("cache_capacity") = kDefaultValueCacheCapacity)
+      .def("set", &ValueTable::Set, py::arg("state"), py::arg("value"))
+      .def("set_lazy", &ValueTable::SetLazy, py::arg("is_lazy"))
+      .def("set_values", &ValueTable::SetValues, py::arg("values"))
+      .def("size", &ValueTable::Size);
+
+  py::enum_<AgentFile::ValueType>(m, "ValueType")
+      .value("FLOAT64", AgentFile::ValueType::kFloat64)
+      .value("FLOAT32", AgentFile::ValueType::kFloat32);
+
+  py::class_<AgentFile>(m, "AgentFile")
+      .def(py::init<const std::string &>(), py::arg("path"))
+      .def("get_action", &AgentFile::GetAction, py::arg("rank"))
+      .def("get_agent_type", &AgentFile::GetAgentType)
+      .def("get_hyperparameters", &AgentFile::GetHyperparameters)
+      .def("get_initial_state", &AgentFile::GetInitialState)
+      .def("get_state_range", &AgentFile::GetStateRange)
+      .def("get_value", &AgentFile::GetValue, py::arg("table"),
+           py::arg("rank"))
+      .def("get_value_type", &AgentFile::GetValueType)
+      .def("has_policy", &AgentFile::HasPolicy)
+      .def("num_tables", &AgentFile::NumTables)
+      .def("read_table", &AgentFile::ReadTable, py::arg("table"),
+           py::arg("values"));
 
   py::class_<Agent, PyAgent<>, SmartPtr<Agent>>(m, "Agent")
       .def(py::init<>())
       .def(py::init<const Agent &>(), py::arg("agent"))
+      .def("get_action_probs",
+           [](Agent &agent, const State &state, bool is_evaluation) {
+             ActionProbs probs;
+             agent.GetActionProbs(state, is_evaluation, &probs);
+             return probs;
+           },
+           py::arg("state"), py::arg("is_evaluation") = true)
       .def("get_current_state", &Agent::GetCurrentState)
       .def("initialize", &Agent::Initialize, py::arg("all_states"))
+      .def("requires_all_states", &Agent::RequiresAllStates)
       .def("reset", &Agent::Reset)
       .def("set_current_state", &Agent::SetCurrentState, py::arg("state"))
       .def("step", &Agent::Step, py::arg("game"), py::arg("is_evaluation"))
       .def("update", &Agent::Update, py::arg("update_state"),
            py::arg("current_state"), py::arg("reward"))
-      .def_property("_current_state", &Agent::GetCurrentState,
+      .def_property("_current_state",
+                    [](const Agent &agent) { return agent.GetCurrentState(); },
                     &Agent::SetCurrentState);
 
   py::class_<HumanAgent,
@@ -330,8 +585,16 @@ PYBIND11_MODULE(pynim, m) {
              SmartPtr<OptimalAgent>>(m, "OptimalAgent")
       .def(py::init<>())
       .def("clone", &OptimalAgent::Clone)
-      .def("policy", &OptimalAgent::Policy, py::arg("state"),
-           py::arg("is_evaluation"));
+      .def("policy",
+           py::overload_cast<const State &, bool>(&OptimalAgent::Policy),
+           py::arg("state"), py::arg("is_evaluation"))
+      .def("policy_batch",
+           [](OptimalAgent &agent, const StateBatch &states) {
+             std::vector<Action> actions;
+             agent.Policy(states, &actions);
+             return actions;
+           },
+           py::arg("states"));
 
   py::class_<RandomAgent,
              Agent,
@@ -342,6 +605,20 @@ PYBIND11_MODULE(pynim, m) {
       .def("policy", &RandomAgent::Policy, py::arg("state"),
            py::arg("is_evaluation"));
 
+  py::class_<Transition>(m, "Transition")
+      .def(py::init<>())
+      .def(py::init([](Agent::Reward reward, const State &state,
+                       const State &next_state,
+                       const State &next_afterstate) {
+             return Transition{reward, state, next_state, next_afterstate};
+           }),
+           py::arg("reward"), py::arg("state"), py::arg("next_state"),
+           py::arg("next_afterstate") = State())
+      .def_readwrite("reward", &Transition::reward)
+      .def_readwrite("state", &Transition::state)
+      .def_readwrite("next_state", &Transition::next_state)
+      .def_readwrite("next_afterstate", &Transition::next_afterstate);
+
   py::class_<RLAgent, Agent, PyRLAgent<>, SmartPtr<RLAgent>>(m, "RLAgent")
       .def(py::init<>())
       .def(py::init<const RLAgent &>(), py::arg("agent"))
@@ -349,22 +626,47 @@ PYBIND11_MODULE(pynim, m) {
       .def("clear_greedy_actions", &RLAgent::ClearGreedyActions)
       .def("get_greedy_actions", &RLAgent::GetGreedyActions)
       .def("get_greedy_value", &RLAgent::GetGreedyValue)
+      .def("get_hyperparameters", &RLAgent::GetHyperparameters)
       .def("get_legal_actions", &RLAgent::GetLegalActions)
+      .def("get_type", &RLAgent::GetType)
+      .def("compact_values", &RLAgent::CompactValues,
+           py::arg("initial_state"), py::arg("precision"),
+           py::arg("cache_capacity") = kDefaultValueCacheCapacity)
+      .def("flush_values", &RLAgent::FlushValues)
+      .def("get_value", &RLAgent::GetValue, py::arg("state"))
       .def("get_values", &RLAgent::GetValues)
       .def("initialize", &RLAgent::Initialize, py::arg("all_states"))
+      .def("is_dense", &RLAgent::IsDense)
+      .def("is_lazy", &RLAgent::IsLazy)
+      .def("is_mapped", &RLAgent::IsMapped)
+      .def("load", &RLAgent::Load, py::arg("path"))
+      .def("map_values", &RLAgent::MapValues, py::arg("path"),
+           py::arg("initial_state"), py::arg("precision") = Precision::kFloat64,
+           py::arg("cache_capacity") = kDefaultValueCacheCapacity)
       .def("optimal_action_ratios", &RLAgent::OptimalActionsRatio)
       .def("policy", &RLAgent::Policy, py::arg("state"),
            py::arg("is_evaluation"))
       .def("policy_impl", &RLAgent::PolicyImpl, py::arg("legal_actions"),
            py::arg("greedy_actions"))
       .def("reset", &RLAgent::Reset)
+      .def("save", &RLAgent::Save, py::arg("path"), py::arg("initial_state"),
+           py::arg("value_type") = AgentFile::ValueType::kFloat64)
       .def("set_greedy_actions", &RLAgent::SetGreedyActions,
            py::arg("greedy_actions"))
       .def("set_greedy_value", &RLAgent::SetGreedyValue,
            py::arg("greedy_value"))
+      .def("set_hyperparameters", &RLAgent::SetHyperparameters,
+           py::arg("hyperparameters"))
+      .def("set_lazy", &RLAgent::SetLazy, py::arg("is_lazy"))
       .def("set_legal_actions", &RLAgent::SetLegalActions,
            py::arg("legal_actions"))
       .def("set_values", &RLAgent::SetValues, py::arg("values"))
+      .def("update_batch",
+           [](RLAgent &agent, const std::vector<Transition> &transitions) {
+             agent.UpdateBatch(transitions.data(), transitions.size());
+           },
+           py::arg("transitions"))
+      .def("update_episode", &RLAgent::UpdateEpisode, py::arg("time_steps"))
       .def("update_exploration", &RLAgent::UpdateExploration,
            py::arg("episode"))
       .def_property("_greedy_value", &RLAgent::GetGreedyValue,
@@ -0,0 +1,110 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/random/rng.h"
+
+#include <mutex>
+#include <random>
+
+namespace nim_rl {
+
+namespace {
+
+thread_local Rng *current_engine = nullptr;
+
+std::uint64_t SplitMix64(std::uint64_t *x) {
+  std::uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// The process seeds one engine from std::random_device and hands each
+// thread a copy, jumping it after every copy, so the threads' streams never
+// overlap.
+Rng NextThreadEngine() {
+  static std::mutex mutex;
+  static Rng root{(static_cast<std::uint64_t>(std::random_device{}()) << 32)
+                  | std::random_device{}()};
+  std::lock_guard<std::mutex> lock(mutex);
+  Rng engine = root;
+  root.Jump();
+  return engine;
+}
+
+Rng &ThreadEngine() {
+  thread_local Rng engine = NextThreadEngine();
+  return engine;
+}
+
+}  // namespace
+
+std::uint64_t Rng::Bounded(std::uint64_t bound) {
+#ifdef __SIZEOF_INT128__
+  // Lemire's method: the high word of x * bound is uniform once the few
+  // products whose low word falls below 2^64 mod bound are rejected.
+  unsigned __int128 product =
+      static_cast<unsigned __int128>((*this)()) * bound;
+  auto low = static_cast<std::uint64_t>(product);
+  if (low < bound) {
+    std::uint64_t threshold = -bound % bound;
+    while (low < threshold) {
+      product = static_cast<unsigned __int128>((*this)()) * bound;
+      low = static_cast<std::uint64_t>(product);
+    }
+  }
+  return static_cast<std::uint64_t>(product >> 64);
+#else
+  std::uint64_t threshold = -bound % bound;
+  std::uint64_t x;
+  do {
+    x = (*this)();
+  } while (x < threshold);
+  return x % bound;
+#endif
+}
+
+void Rng::Jump() {
+  static constexpr std::uint64_t kJump[] = {
+      0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL,
+      0x39abdc4529b1661cULL};
+  std::uint64_t state[4] = {};
+  for (std::uint64_t jump : kJump) {
+    for (int bit = 0; bit != 64; ++bit) {
+      if (jump & (1ULL << bit)) {
+        for (int i = 0; i != 4; ++i) state[i] ^= state_[i];
+      }
+      (*this)();
+    }
+  }
+  for (int i = 0; i != 4; ++i) state_[i] = state[i];
+}
+
+void Rng::Seed(std::uint64_t seed) {
+  for (auto &word : state_) word = SplitMix64(&seed);
+}
+
+Rng &RandomEngine() {
+  return current_engine ? *current_engine : ThreadEngine();
+}
+
+void SeedRandomEngine(std::uint64_t seed) { RandomEngine().Seed(seed); }
+
+RngScope::RngScope(Rng *rng) : previous_(current_engine) {
+  if (rng) current_engine = rng;
+}
+
+RngScope::~RngScope() { current_engine = previous_; }
+
+}  // namespace nim_rl
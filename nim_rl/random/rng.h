@@ -0,0 +1,90 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_RANDOM_RNG_H_
+#define NIM_RL_RANDOM_RNG_H_
+
+#include <climits>
+#include <cstdint>
+
+namespace nim_rl {
+
+constexpr std::uint64_t kDefaultSeed = 0x853c49e6748fea9bULL;
+
+// xoshiro256** (Blackman and Vigna): 256 bits of state and a few shifts,
+// rotations and multiplications per number. It is a standard uniform random
+// bit generator, so <random> distributions accept it, but the members below
+// draw the common distributions without constructing one per call.
+class Rng {
+ public:
+  using result_type = std::uint64_t;
+  explicit Rng(std::uint64_t seed = kDefaultSeed) { Seed(seed); }
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+  // Whether a draw in [0, 1) falls below p.
+  bool Bernoulli(double p) { return Uniform() < p; }
+  // Uniform in [0, bound), without modulo bias. bound must be positive.
+  std::uint64_t Bounded(std::uint64_t bound);
+  // Advances the sequence by 2^128 numbers, so that engines jumped different
+  // times from one seed draw non-overlapping streams.
+  void Jump();
+  // Expands the seed into the state with SplitMix64, as the authors advise.
+  void Seed(std::uint64_t seed);
+  // Uniform in [0, 1), with 53 random bits.
+  double Uniform() { return ((*this)() >> 11) * (1.0 / (1ULL << 53)); }
+  result_type operator()() {
+    std::uint64_t result = Rotl(state_[1] * 5, 7) * 9;
+    std::uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = Rotl(state_[3], 45);
+    return result;
+  }
+
+ private:
+  std::uint64_t state_[4];
+  static std::uint64_t Rotl(std::uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+};
+
+// The engine behind the random choices made on the calling thread: the one
+// installed by the innermost RngScope, or else the thread's own, which is
+// jumped off one engine seeded from std::random_device. Threads never share
+// an engine unless a scope makes them, so games may train on several threads
+// at once.
+Rng &RandomEngine();
+
+// Reseeds RandomEngine(), making what follows on the thread reproducible.
+void SeedRandomEngine(std::uint64_t seed);
+
+// Makes rng the calling thread's RandomEngine() until destroyed. A nullptr
+// leaves the current engine in place.
+class RngScope {
+ public:
+  explicit RngScope(Rng *rng);
+  RngScope(const RngScope &) = delete;
+  RngScope &operator=(const RngScope &) = delete;
+  ~RngScope();
+
+ private:
+  Rng *previous_;
+};
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_RANDOM_RNG_H_
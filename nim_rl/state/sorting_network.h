@@ -0,0 +1,92 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_STATE_SORTING_NETWORK_H_
+#define NIM_RL_STATE_SORTING_NETWORK_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+
+namespace nim_rl {
+
+// States with up to this many piles are sorted by an unrolled network.
+constexpr std::size_t kMaxNetworkPiles = 6;
+
+namespace internal {
+
+template<std::size_t I, std::size_t J>
+inline void CompareExchange(unsigned *data) {
+  unsigned lo = std::min(data[I], data[J]);
+  unsigned hi = std::max(data[I], data[J]);
+  data[I] = lo;
+  data[J] = hi;
+}
+
+// Sinks data[J] into the sorted prefix data[0, J).
+template<std::size_t J>
+struct InsertionNetwork {
+  static void Apply(unsigned *data) {
+    CompareExchange<J - 1, J>(data);
+    InsertionNetwork<J - 1>::Apply(data);
+  }
+};
+
+template<>
+struct InsertionNetwork<0> {
+  static void Apply(unsigned * /*data*/) {}
+};
+
+// Branch-free sort of N piles, fully unrolled at compile time.
+template<std::size_t N>
+struct SortingNetwork {
+  static void Apply(unsigned *data) {
+    SortingNetwork<N - 1>::Apply(data);
+    InsertionNetwork<N - 1>::Apply(data);
+  }
+};
+
+template<>
+struct SortingNetwork<0> {
+  static void Apply(unsigned * /*data*/) {}
+};
+
+// Sorts data in place with the network matching size. Returns false when
+// size exceeds kMaxNetworkPiles and the caller has to fall back to std::sort.
+inline bool SortSmall(unsigned *data, std::size_t size) {
+  switch (size) {
+    case 0:
+    case 1: return true;
+    case 2: SortingNetwork<2>::Apply(data); return true;
+    case 3: SortingNetwork<3>::Apply(data); return true;
+    case 4: SortingNetwork<4>::Apply(data); return true;
+    case 5: SortingNetwork<5>::Apply(data); return true;
+    case 6: SortingNetwork<6>::Apply(data); return true;
+    default: return false;
+  }
+}
+
+inline std::size_t HashSorted(const unsigned *data, std::size_t size) {
+  std::size_t seed = 0;
+  for (std::size_t pile_id = 0; pile_id != size; ++pile_id)
+    seed ^= std::hash<unsigned>()(data[pile_id]) + 0x9e3779b9
+        + (seed << 6u) + (seed >> 2u);
+  return seed;
+}
+
+}  // namespace internal
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_STATE_SORTING_NETWORK_H_
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "nim_rl/state/state.h"
+#include "nim_rl/state/state_range.h"
 
 namespace nim_rl {
 
@@ -70,42 +71,19 @@ State State::Child(const Action &action) const {
 
 std::vector<State> State::Children() const {
   std::vector<State> children;
-  State state(*this);
-  if (state.IsTerminal()) {
-    children.emplace_back();
-  } else {
-    for (int pile_id = 0; pile_id != data_.size(); ++pile_id) {
-      for (int num_objects = 0; num_objects != data_[pile_id]; ++num_objects) {
-        state[pile_id] = static_cast<unsigned>(num_objects);
-        children.push_back(state);
-      }
-      state[pile_id] = data_[pile_id];
-    }
-  }
+  Children(&children);
   return children;
 }
 
+std::uint64_t State::CountStates() const {
+  return StateRange(*this).Size();
+}
+
 std::vector<State> State::GetAllStates() const {
-  std::vector<unsigned> initial_state(data_);
-  std::sort(initial_state.begin(), initial_state.end());
+  StateRange state_range(*this);
   std::vector<State> all_states;
-  all_states.reserve(initial_state[0] + 1);
-  for (int num_objects = 0; num_objects != initial_state[0] + 1;
-       ++num_objects)
-    all_states.emplace_back(1, num_objects);
-  std::vector<State> new_all_states;
-  for (int pile_id = 1; pile_id < initial_state.size(); ++pile_id) {
-    for (const auto &state : all_states) {
-      for (unsigned num_objects = state.data_.back();
-           num_objects != initial_state[pile_id] + 1; ++num_objects) {
-        State next_state(state);
-        next_state.data_.push_back(num_objects);
-        new_all_states.emplace_back(std::move(next_state));
-      }
-    }
-    std::swap(all_states, new_all_states);
-    new_all_states.clear();
-  }
+  all_states.reserve(state_range.Size());
+  for (const auto &state : state_range) all_states.push_back(state);
   return all_states;
 }
 
@@ -117,11 +95,23 @@ bool State::IsTerminal() const {
 
 std::vector<Action> State::LegalActions() const {
   std::vector<Action> legal_actions;
+  LegalActions(&legal_actions);
+  return legal_actions;
+}
+
+void State::LegalActions(std::vector<Action> *legal_actions) const {
+  legal_actions->clear();
   for (int pile_id = 0; pile_id != data_.size(); ++pile_id)
     for (int num_objects = 1; num_objects != data_[pile_id] + 1;
          ++num_objects)
-      legal_actions.emplace_back(pile_id, num_objects);
-  return legal_actions;
+      legal_actions->emplace_back(pile_id, num_objects);
+}
+
+int State::NumLegalActions() const {
+  int num_legal_actions = 0;
+  for (int pile_id = 0; pile_id != data_.size(); ++pile_id)
+    num_legal_actions += data_[pile_id];
+  return num_legal_actions;
 }
 
 unsigned State::NimSum() const {
@@ -196,6 +186,17 @@ std::ostream &operator<<(std::ostream &os, const State &state) {
 }
 
 bool operator==(const State &lhs, const State &rhs) {
+  std::size_t size = lhs.data_.size();
+  if (size != rhs.data_.size()) return false;
+  if (size <= kMaxNetworkPiles) {
+    std::array<unsigned, kMaxNetworkPiles> lhs_sorted, rhs_sorted;
+    std::copy(lhs.data_.begin(), lhs.data_.end(), lhs_sorted.begin());
+    std::copy(rhs.data_.begin(), rhs.data_.end(), rhs_sorted.begin());
+    internal::SortSmall(lhs_sorted.data(), size);
+    internal::SortSmall(rhs_sorted.data(), size);
+    return std::equal(lhs_sorted.begin(), lhs_sorted.begin() + size,
+                      rhs_sorted.begin());
+  }
   std::vector<unsigned> lhs_sorted(lhs.data_), rhs_sorted(rhs.data_);
   std::sort(lhs_sorted.begin(), lhs_sorted.end());
   std::sort(rhs_sorted.begin(), rhs_sorted.end());
@@ -16,8 +16,11 @@
 #define NIM_RL_STATE_STATE_H_
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <initializer_list>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -25,13 +28,19 @@
 #include <vector>
 
 #include "nim_rl/action/action.h"
+#include "nim_rl/state/sorting_network.h"
 
 namespace nim_rl {
 
+class ChildRange;
+class LegalActionRange;
+
 class State {
   friend void swap(State &, State &);
   friend bool operator==(const State &, const State &);
   friend class std::hash<State>;
+  friend class ChildIterator;
+  friend class LegalActionIterator;
 
  public:
   using size_type = std::vector<unsigned>::size_type;
@@ -50,11 +59,18 @@ class State {
   void ApplyAction(const Action &);
   State Child(const Action &) const;
   std::vector<State> Children() const;
+  template<typename Allocator>
+  void Children(std::vector<State, Allocator> *) const;
+  ChildRange ChildrenView() const;
   void Clear() { data_.clear(); }
+  std::uint64_t CountStates() const;
   std::vector<State> GetAllStates() const;
   bool IsEmpty() const { return data_.empty(); }
   bool IsTerminal() const;
   std::vector<Action> LegalActions() const;
+  void LegalActions(std::vector<Action> *) const;
+  LegalActionRange LegalActionsView() const;
+  int NumLegalActions() const;
   unsigned NimSum() const;
   bool OutOfRange(int pile_id) const {
     return pile_id >= data_.size() || pile_id < 0;
@@ -68,8 +84,9 @@ class State {
 
  private:
   std::vector<unsigned> data_;
+  // Takes a C string, so that checking in range never allocates.
   void CheckRange(int pile_id,
-                  const std::string &msg = "Pile_id is out of range.") const;
+                  const char *msg = "Pile_id is out of range.") const;
   void DoGetAllStates(const State &state, int pile_id,
                       std::vector<State> *all_states) const;
 };
@@ -79,10 +96,147 @@ std::ostream &operator<<(std::ostream &, const State &);
 bool operator==(const State &, const State &);
 bool operator!=(const State &, const State &);
 
-inline void State::CheckRange(int pile_id, const std::string &msg) const {
+// Iterates over the legal actions of a state without materializing them, in
+// the same order as State::LegalActions.
+class LegalActionIterator {
+ public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = Action;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const Action *;
+  using reference = const Action &;
+  LegalActionIterator() = default;
+  LegalActionIterator(const State *state, int pile_id)
+      : state_(state), action_(pile_id, 1) { SkipEmptyPiles(); }
+  reference operator*() const { return action_; }
+  pointer operator->() const { return &action_; }
+  LegalActionIterator &operator++() {
+    if (action_.GetNumObjects() < state_->data_[action_.GetPileId()]) {
+      action_.SetNumObjects(action_.GetNumObjects() + 1);
+    } else {
+      action_ = Action(action_.GetPileId() + 1, 1);
+      SkipEmptyPiles();
+    }
+    return *this;
+  }
+  LegalActionIterator operator++(int) {
+    LegalActionIterator iter(*this);
+    ++*this;
+    return iter;
+  }
+  friend bool operator==(const LegalActionIterator &lhs,
+                         const LegalActionIterator &rhs) {
+    return lhs.action_ == rhs.action_;
+  }
+  friend bool operator!=(const LegalActionIterator &lhs,
+                         const LegalActionIterator &rhs) {
+    return !(lhs == rhs);
+  }
+
+ private:
+  const State *state_ = nullptr;
+  Action action_;
+  void SkipEmptyPiles() {
+    while (action_.GetPileId() < state_->Size() &&
+        !state_->data_[action_.GetPileId()])
+      action_.SetPileId(action_.GetPileId() + 1);
+  }
+};
+
+class LegalActionRange {
+ public:
+  explicit LegalActionRange(const State *state) : state_(state) {}
+  LegalActionIterator begin() const { return {state_, 0}; }
+  LegalActionIterator end() const {
+    return {state_, static_cast<int>(state_->Size())};
+  }
+
+ private:
+  const State *state_;
+};
+
+// Iterates over the children of a state in the order of its legal actions.
+// The child is updated in place, so only begin() copies the parent state.
+class ChildIterator {
+ public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = State;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const State *;
+  using reference = const State &;
+  ChildIterator() = default;
+  ChildIterator(const State *state, LegalActionIterator action_iter)
+      : state_(state), action_iter_(action_iter) {}
+  reference operator*() const { return child_; }
+  pointer operator->() const { return &child_; }
+  ChildIterator &operator++() {
+    int pile_id = action_iter_->GetPileId();
+    ++action_iter_;
+    if (action_iter_->GetPileId() != pile_id) {
+      child_.data_[pile_id] = state_->data_[pile_id];
+      if (action_iter_->GetPileId() < state_->Size()) Apply();
+    } else {
+      --child_.data_[pile_id];
+    }
+    return *this;
+  }
+  const Action &GetAction() const { return *action_iter_; }
+  friend bool operator==(const ChildIterator &lhs, const ChildIterator &rhs) {
+    return lhs.action_iter_ == rhs.action_iter_;
+  }
+  friend bool operator!=(const ChildIterator &lhs, const ChildIterator &rhs) {
+    return !(lhs == rhs);
+  }
+
+ private:
+  friend class ChildRange;
+  const State *state_ = nullptr;
+  LegalActionIterator action_iter_;
+  State child_;
+  void Apply() {
+    child_.data_[action_iter_->GetPileId()] -= action_iter_->GetNumObjects();
+  }
+};
+
+class ChildRange {
+ public:
+  explicit ChildRange(const State *state) : state_(state) {}
+  ChildIterator begin() const {
+    ChildIterator iter(state_, LegalActionRange(state_).begin());
+    iter.child_ = *state_;
+    if (iter.action_iter_->GetPileId() < state_->Size()) iter.Apply();
+    return iter;
+  }
+  ChildIterator end() const {
+    return {state_, LegalActionRange(state_).end()};
+  }
+
+ private:
+  const State *state_;
+};
+
+inline void State::CheckRange(int pile_id, const char *msg) const {
   if (OutOfRange(pile_id)) throw std::out_of_range(msg);
 }
 
+template<typename Allocator>
+void State::Children(std::vector<State, Allocator> *children) const {
+  if (IsTerminal()) {
+    children->resize(1);
+    children->front().Clear();
+  } else {
+    children->resize(NumLegalActions());
+    auto child_iter = children->begin();
+    for (const auto &child : ChildrenView()) *child_iter++ = child;
+  }
+}
+
+inline ChildRange State::ChildrenView() const { return ChildRange(this); }
+
+inline LegalActionRange State::LegalActionsView() const {
+  return LegalActionRange(this);
+}
+
 inline void swap(State &lhs, State &rhs) {
   using std::swap;
   swap(lhs.data_, rhs.data_);
@@ -95,14 +249,16 @@ using nim_rl::State;
 template<>
 struct hash<State> {
   std::size_t operator()(const State &state) const {
+    std::size_t size = state.data_.size();
+    if (size <= nim_rl::kMaxNetworkPiles) {
+      std::array<unsigned, nim_rl::kMaxNetworkPiles> state_sorted;
+      std::copy(state.data_.begin(), state.data_.end(), state_sorted.begin());
+      nim_rl::internal::SortSmall(state_sorted.data(), size);
+      return nim_rl::internal::HashSorted(state_sorted.data(), size);
+    }
     std::vector<unsigned> state_sorted(state.data_);
     std::sort(state_sorted.begin(), state_sorted.end());
-    std::size_t seed = 0;
-    for (int pile_id = 0; pile_id != state_sorted.size(); ++pile_id) {
-      seed ^= std::hash<unsigned>()(state_sorted[pile_id]) + 0x9e3779b9
-          + (seed << 6u) + (seed >> 2u);
-    }
-    return seed;
+    return nim_rl::internal::HashSorted(state_sorted.data(), size);
   }
 };
 }  // namespace std
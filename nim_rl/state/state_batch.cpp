@@ -0,0 +1,179 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/state/state_batch.h"
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace nim_rl {
+
+namespace {
+
+void XorInto(const unsigned *src, unsigned *dst, std::size_t n) {
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    auto *d = reinterpret_cast<__m256i *>(dst + i);
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    _mm256_storeu_si256(d, _mm256_xor_si256(_mm256_loadu_si256(d), s));
+  }
+#elif defined(__SSE4_1__)
+  for (; i + 4 <= n; i += 4) {
+    auto *d = reinterpret_cast<__m128i *>(dst + i);
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    _mm_storeu_si128(d, _mm_xor_si128(_mm_loadu_si128(d), s));
+  }
+#endif
+  for (; i != n; ++i) dst[i] ^= src[i];
+}
+
+void OrInto(const unsigned *src, unsigned *dst, std::size_t n) {
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    auto *d = reinterpret_cast<__m256i *>(dst + i);
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    _mm256_storeu_si256(d, _mm256_or_si256(_mm256_loadu_si256(d), s));
+  }
+#elif defined(__SSE4_1__)
+  for (; i + 4 <= n; i += 4) {
+    auto *d = reinterpret_cast<__m128i *>(dst + i);
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    _mm_storeu_si128(d, _mm_or_si128(_mm_loadu_si128(d), s));
+  }
+#endif
+  for (; i != n; ++i) dst[i] |= src[i];
+}
+
+// Compare-exchange of two whole piles: afterwards lo[i] <= hi[i] for all i.
+void CompareExchange(unsigned *lo, unsigned *hi, std::size_t n) {
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    auto *l = reinterpret_cast<__m256i *>(lo + i);
+    auto *h = reinterpret_cast<__m256i *>(hi + i);
+    __m256i a = _mm256_loadu_si256(l), b = _mm256_loadu_si256(h);
+    _mm256_storeu_si256(l, _mm256_min_epu32(a, b));
+    _mm256_storeu_si256(h, _mm256_max_epu32(a, b));
+  }
+#elif defined(__SSE4_1__)
+  for (; i + 4 <= n; i += 4) {
+    auto *l = reinterpret_cast<__m128i *>(lo + i);
+    auto *h = reinterpret_cast<__m128i *>(hi + i);
+    __m128i a = _mm_loadu_si128(l), b = _mm_loadu_si128(h);
+    _mm_storeu_si128(l, _mm_min_epu32(a, b));
+    _mm_storeu_si128(h, _mm_max_epu32(a, b));
+  }
+#endif
+  for (; i != n; ++i) {
+    unsigned a = lo[i], b = hi[i];
+    lo[i] = std::min(a, b);
+    hi[i] = std::max(a, b);
+  }
+}
+
+}  // namespace
+
+StateBatch::StateBatch(const std::vector<State> &states) {
+  if (states.empty()) return;
+  piles_.resize(states[0].Size());
+  Reserve(states.size());
+  for (const auto &state : states) PushBack(state);
+}
+
+// Sorts the piles of every state with an insertion network over whole piles,
+// so the result matches sorting each State on its own.
+void StateBatch::Canonicalize() {
+  size_type size = Size();
+  for (size_type pile_id = 1; pile_id < piles_.size(); ++pile_id)
+    for (size_type lo = pile_id; lo--;)
+      CompareExchange(piles_[lo].data(), piles_[lo + 1].data(), size);
+}
+
+// Applies actions[i] to state i. As with State::Child, an illegal action
+// leaves the state unchanged, but so does any action on a terminal state,
+// which State::Child maps to the empty state.
+void StateBatch::Child(const std::vector<Action> &actions,
+                       StateBatch *children) const {
+  if (actions.size() != Size())
+    throw std::invalid_argument("Need exactly one action per state");
+  *children = *this;
+  for (size_type i = 0; i != actions.size(); ++i) {
+    int pile_id = actions[i].GetPileId();
+    int num_objects = actions[i].GetNumObjects();
+    if (pile_id < 0 || pile_id >= static_cast<int>(piles_.size())
+        || num_objects < 1
+        || static_cast<unsigned>(num_objects) > piles_[pile_id][i])
+      continue;
+    children->piles_[pile_id][i] -= num_objects;
+  }
+}
+
+void StateBatch::Clear() {
+  for (auto &pile : piles_) pile.clear();
+}
+
+State StateBatch::Get(size_type index) const {
+  std::vector<unsigned> data(piles_.size());
+  for (size_type pile_id = 0; pile_id != piles_.size(); ++pile_id)
+    data[pile_id] = piles_[pile_id].at(index);
+  return State(std::move(data));
+}
+
+// Matches std::hash<State> for every state in the batch.
+void StateBatch::Hash(std::vector<std::size_t> *hashes) const {
+  StateBatch canonical(*this);
+  canonical.Canonicalize();
+  hashes->assign(Size(), 0);
+  std::size_t *seeds = hashes->data();
+  for (const auto &pile : canonical.piles_)
+    for (size_type i = 0; i != pile.size(); ++i)
+      seeds[i] ^= std::hash<unsigned>()(pile[i]) + 0x9e3779b9
+          + (seeds[i] << 6u) + (seeds[i] >> 2u);
+}
+
+void StateBatch::IsTerminal(std::vector<unsigned char> *is_terminal) const {
+  std::vector<unsigned> any_objects(Size(), 0);
+  for (const auto &pile : piles_)
+    OrInto(pile.data(), any_objects.data(), any_objects.size());
+  is_terminal->resize(any_objects.size());
+  for (size_type i = 0; i != any_objects.size(); ++i)
+    (*is_terminal)[i] = !any_objects[i];
+}
+
+void StateBatch::NimSum(std::vector<unsigned> *nim_sums) const {
+  nim_sums->assign(Size(), 0);
+  for (const auto &pile : piles_)
+    XorInto(pile.data(), nim_sums->data(), nim_sums->size());
+}
+
+void StateBatch::PushBack(const State &state) {
+  if (piles_.empty()) piles_.resize(state.Size());
+  if (state.Size() != piles_.size())
+    throw std::invalid_argument("All states in a batch need the same piles");
+  for (size_type pile_id = 0; pile_id != piles_.size(); ++pile_id)
+    piles_[pile_id].push_back(state[pile_id]);
+}
+
+void StateBatch::Reserve(size_type capacity) {
+  for (auto &pile : piles_) pile.reserve(capacity);
+}
+
+}  // namespace nim_rl
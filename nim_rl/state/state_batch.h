@@ -0,0 +1,60 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_STATE_STATE_BATCH_H_
+#define NIM_RL_STATE_STATE_BATCH_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "nim_rl/action/action.h"
+#include "nim_rl/state/state.h"
+
+namespace nim_rl {
+
+// A batch of states with the same number of piles, stored pile-major: pile p
+// of every state is contiguous, so the kernels below process one pile of many
+// states per instruction. They use AVX2 or SSE4.1 when the compiler targets
+// them and plain loops otherwise.
+class StateBatch {
+ public:
+  using size_type = std::vector<unsigned>::size_type;
+  StateBatch() = default;
+  explicit StateBatch(size_type num_piles) : piles_(num_piles) {}
+  explicit StateBatch(const std::vector<State> &);
+  StateBatch(const StateBatch &) = default;
+  StateBatch(StateBatch &&) = default;
+  StateBatch &operator=(const StateBatch &) = default;
+  StateBatch &operator=(StateBatch &&) = default;
+  ~StateBatch() = default;
+  void Canonicalize();
+  void Child(const std::vector<Action> &actions, StateBatch *children) const;
+  void Clear();
+  State Get(size_type index) const;
+  void Hash(std::vector<std::size_t> *hashes) const;
+  void IsTerminal(std::vector<unsigned char> *is_terminal) const;
+  void NimSum(std::vector<unsigned> *nim_sums) const;
+  size_type NumPiles() const { return piles_.size(); }
+  const unsigned *Pile(int pile_id) const { return piles_[pile_id].data(); }
+  void PushBack(const State &);
+  void Reserve(size_type capacity);
+  size_type Size() const { return piles_.empty() ? 0 : piles_[0].size(); }
+
+ private:
+  std::vector<std::vector<unsigned>> piles_;
+};
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_STATE_STATE_BATCH_H_
@@ -0,0 +1,131 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/state/state_range.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "nim_rl/state/sorting_network.h"
+
+namespace nim_rl {
+
+StateRange::Iterator::Iterator(const StateRange *range, Rank rank)
+    : range_(range), rank_(rank) {
+  if (rank_ < range_->end_rank_) state_ = range_->Unrank(rank_);
+}
+
+// Moves to the lexicographic successor: bump the last pile that is below its
+// bound and level every pile after it down to the bumped one.
+StateRange::Iterator &StateRange::Iterator::operator++() {
+  if (++rank_ >= range_->end_rank_) return *this;
+  int pile_id = static_cast<int>(state_.Size()) - 1;
+  while (state_[pile_id] == range_->max_piles_[pile_id]) --pile_id;
+  unsigned num_objects = ++state_[pile_id];
+  for (++pile_id; pile_id != state_.Size(); ++pile_id)
+    state_[pile_id] = num_objects;
+  return *this;
+}
+
+StateRange::StateRange(const State &initial_state)
+    : max_piles_(initial_state.Size()) {
+  for (int pile_id = 0; pile_id != max_piles_.size(); ++pile_id)
+    max_piles_[pile_id] = initial_state[pile_id];
+  std::sort(max_piles_.begin(), max_piles_.end());
+  auto num_completions =
+      std::make_shared<std::vector<std::vector<Rank>>>(max_piles_.size());
+  num_completions_ = num_completions;
+  for (auto pile_id = max_piles_.size(); pile_id--;) {
+    auto &row = (*num_completions)[pile_id];
+    row.resize(max_piles_[pile_id] + 1);
+    for (auto lo = max_piles_[pile_id] + 1; lo--;)
+      row[lo] = NumCompletions(pile_id, lo + 1)
+          + NumCompletions(pile_id + 1, lo);
+  }
+  end_rank_ = NumCompletions(0, 0);
+}
+
+// Every dense value access ranks a state, so the piles are sorted on the
+// stack with the sorting network, and only larger states use a scratch
+// vector of the thread.
+StateRange::Rank StateRange::RankOf(const State &state) const {
+  std::size_t num_piles = state.Size();
+  if (num_piles != max_piles_.size())
+    throw std::out_of_range("State does not belong to this range.");
+  if (num_piles <= kMaxNetworkPiles) {
+    std::array<unsigned, kMaxNetworkPiles> piles;
+    for (int pile_id = 0; pile_id != num_piles; ++pile_id)
+      piles[pile_id] = state[pile_id];
+    internal::SortSmall(piles.data(), num_piles);
+    return RankOfSorted(piles.data());
+  }
+  thread_local std::vector<unsigned> piles;
+  piles.resize(num_piles);
+  for (int pile_id = 0; pile_id != num_piles; ++pile_id)
+    piles[pile_id] = state[pile_id];
+  std::sort(piles.begin(), piles.end());
+  return RankOfSorted(piles.data());
+}
+
+std::vector<StateRange> StateRange::Split(int num_parts) const {
+  if (num_parts < 1) throw std::invalid_argument("num_parts must >= 1");
+  std::vector<StateRange> parts(num_parts, *this);
+  Rank quotient = Size() / num_parts, remainder = Size() % num_parts;
+  for (int part = 0; part != num_parts; ++part) {
+    parts[part].begin_rank_ = begin_rank_ + quotient * part
+        + std::min<Rank>(part, remainder);
+    parts[part].end_rank_ = parts[part].begin_rank_ + quotient
+        + (part < remainder ? 1 : 0);
+  }
+  return parts;
+}
+
+State StateRange::Unrank(Rank rank) const {
+  if (rank >= NumCompletions(0, 0))
+    throw std::out_of_range("Rank is out of range.");
+  std::vector<unsigned> piles(max_piles_.size());
+  unsigned num_objects = 0;
+  for (std::size_t pile_id = 0; pile_id != piles.size(); ++pile_id) {
+    for (;; ++num_objects) {
+      Rank count = NumCompletions(pile_id + 1, num_objects);
+      if (rank < count) break;
+      rank -= count;
+    }
+    piles[pile_id] = num_objects;
+  }
+  return State(std::move(piles));
+}
+
+StateRange::Rank StateRange::RankOfSorted(const unsigned *piles) const {
+  Rank rank = 0;
+  unsigned lo = 0;
+  for (std::size_t pile_id = 0; pile_id != max_piles_.size(); ++pile_id) {
+    if (piles[pile_id] > max_piles_[pile_id])
+      throw std::out_of_range("State does not belong to this range.");
+    rank += NumCompletions(pile_id, lo)
+        - NumCompletions(pile_id, piles[pile_id]);
+    lo = piles[pile_id];
+  }
+  return rank;
+}
+
+StateRange::Rank StateRange::NumCompletions(std::size_t pile_id,
+                                            unsigned lo) const {
+  if (pile_id == max_piles_.size()) return 1;
+  if (lo > max_piles_[pile_id]) return 0;
+  return (*num_completions_)[pile_id][lo];
+}
+
+}  // namespace nim_rl
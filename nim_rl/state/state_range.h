@@ -0,0 +1,88 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_STATE_STATE_RANGE_H_
+#define NIM_RL_STATE_STATE_RANGE_H_
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "nim_rl/state/state.h"
+
+namespace nim_rl {
+
+// The canonical states reachable from an initial state, i.e. the sorted pile
+// vectors bounded pile by pile by the sorted initial state, in the same
+// lexicographic order as State::GetAllStates. States are generated one at a
+// time, and every state has a dense rank, so a range can be split into
+// independent sub-ranges or sampled without materializing it.
+class StateRange {
+ public:
+  using Rank = std::uint64_t;
+
+  class Iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = State;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const State *;
+    using reference = const State &;
+    Iterator() = default;
+    Iterator(const StateRange *range, Rank rank);
+    reference operator*() const { return state_; }
+    pointer operator->() const { return &state_; }
+    Iterator &operator++();
+    Rank GetRank() const { return rank_; }
+    friend bool operator==(const Iterator &lhs, const Iterator &rhs) {
+      return lhs.rank_ == rhs.rank_;
+    }
+    friend bool operator!=(const Iterator &lhs, const Iterator &rhs) {
+      return !(lhs == rhs);
+    }
+
+   private:
+    const StateRange *range_ = nullptr;
+    Rank rank_ = 0;
+    State state_;
+  };
+
+  StateRange() : StateRange(State()) {}
+  explicit StateRange(const State &initial_state);
+  Iterator begin() const { return {this, begin_rank_}; }
+  Iterator end() const { return {this, end_rank_}; }
+  Rank GetBeginRank() const { return begin_rank_; }
+  Rank GetEndRank() const { return end_rank_; }
+  Rank Size() const { return end_rank_ - begin_rank_; }
+  Rank RankOf(const State &) const;
+  // Splits the range into num_parts contiguous sub-ranges in rank order,
+  // whose sizes differ by at most one. Some may be empty.
+  std::vector<StateRange> Split(int num_parts) const;
+  State Unrank(Rank rank) const;
+
+ private:
+  std::vector<unsigned> max_piles_;
+  // num_completions_[i][lo] counts the ways to fill piles i, i + 1, ... when
+  // pile i holds at least lo objects.
+  std::shared_ptr<const std::vector<std::vector<Rank>>> num_completions_;
+  Rank begin_rank_ = 0;
+  Rank end_rank_ = 0;
+  Rank NumCompletions(std::size_t pile_id, unsigned lo) const;
+  Rank RankOfSorted(const unsigned *piles) const;
+};
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_STATE_STATE_RANGE_H_
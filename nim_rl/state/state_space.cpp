@@ -0,0 +1,93 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/state/state_space.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace nim_rl {
+
+StateSpace::StateSpace(const State &initial_state)
+    : state_range_(initial_state) {
+  if (state_range_.Size() > std::numeric_limits<Index>::max())
+    throw std::length_error("State space is too large to index.");
+  states_.reserve(state_range_.Size());
+  for (const auto &state : state_range_) states_.push_back(state);
+}
+
+// The cache lock only guards the map: a space is built under a lock of its
+// own key, so building one does not hold up Get on other initial states,
+// and entries whose spaces have expired are dropped once no Get holds them.
+std::shared_ptr<const StateSpace> StateSpace::Get(const State &initial_state) {
+  struct Entry {
+    std::mutex mutex;
+    std::weak_ptr<const StateSpace> state_space;
+  };
+  static std::mutex mutex;
+  static std::unordered_map<State, std::shared_ptr<Entry>> cache;
+  std::shared_ptr<Entry> entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto iter = cache.begin(); iter != cache.end();) {
+      std::unique_lock<std::mutex> entry_lock(iter->second->mutex,
+                                              std::try_to_lock);
+      if (entry_lock && iter->second.use_count() == 1
+          && iter->second->state_space.expired()) {
+        entry_lock.unlock();
+        iter = cache.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+    auto &cached = cache[initial_state];
+    if (!cached) cached = std::make_shared<Entry>();
+    entry = cached;
+  }
+  std::lock_guard<std::mutex> lock(entry->mutex);
+  auto state_space = entry->state_space.lock();
+  if (!state_space) {
+    state_space = std::make_shared<const StateSpace>(initial_state);
+    entry->state_space = state_space;
+  }
+  return state_space;
+}
+
+std::pair<const StateSpace::Index *, const StateSpace::Index *>
+StateSpace::GetChildren(Index index) const {
+  std::call_once(adjacency_flag_, [this] { BuildAdjacency(); });
+  const Index *children = children_.data();
+  return {children + child_offsets_[index],
+          children + child_offsets_[index + 1]};
+}
+
+void StateSpace::BuildAdjacency() const {
+  child_offsets_.reserve(states_.size() + 1);
+  child_offsets_.push_back(0);
+  for (const auto &state : states_) {
+    auto first_child = children_.size();
+    for (const auto &child : state.ChildrenView())
+      children_.push_back(IndexOf(child));
+    std::sort(children_.begin() + first_child, children_.end());
+    children_.erase(std::unique(children_.begin() + first_child,
+                                children_.end()),
+                    children_.end());
+    child_offsets_.push_back(children_.size());
+  }
+  children_.shrink_to_fit();
+}
+
+}  // namespace nim_rl
@@ -0,0 +1,64 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_STATE_STATE_SPACE_H_
+#define NIM_RL_STATE_STATE_SPACE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "nim_rl/state/state.h"
+#include "nim_rl/state/state_range.h"
+
+namespace nim_rl {
+
+// Every canonical state reachable from an initial state, indexed by its rank
+// in StateRange, together with the edges to its distinct canonical children.
+// A StateSpace never changes after construction, so one instance is shared by
+// every Game and agent on the same initial state; Get hands it out from a
+// process-wide cache for as long as anyone holds it.
+class StateSpace {
+ public:
+  using Index = std::uint32_t;
+  explicit StateSpace(const State &initial_state);
+  StateSpace(const StateSpace &) = delete;
+  StateSpace &operator=(const StateSpace &) = delete;
+  ~StateSpace() = default;
+  static std::shared_ptr<const StateSpace> Get(const State &initial_state);
+  std::pair<const Index *, const Index *> GetChildren(Index index) const;
+  const State &GetState(Index index) const { return states_[index]; }
+  const StateRange &GetStateRange() const { return state_range_; }
+  const std::vector<State> &GetStates() const { return states_; }
+  Index IndexOf(const State &state) const {
+    return static_cast<Index>(state_range_.RankOf(state));
+  }
+  Index Size() const { return static_cast<Index>(states_.size()); }
+
+ private:
+  StateRange state_range_;
+  std::vector<State> states_;
+  // Compressed sparse rows, built on the first GetChildren call since most
+  // users only need the states.
+  mutable std::once_flag adjacency_flag_;
+  mutable std::vector<std::size_t> child_offsets_;
+  mutable std::vector<Index> children_;
+  void BuildAdjacency() const;
+};
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_STATE_STATE_SPACE_H_
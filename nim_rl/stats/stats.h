@@ -0,0 +1,132 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_STATS_STATS_H_
+#define NIM_RL_STATS_STATS_H_
+
+#include <chrono>
+#include <cstdint>
+
+namespace nim_rl {
+
+// What one player spent during Game::Train. The counters and the policy and
+// update timers come from the macros below, which only exist in builds with
+// NIM_RL_STATS defined (the NIM_RL_STATS CMake option) and stay zero
+// otherwise.
+struct AgentStats {
+  std::uint64_t steps = 0;
+  std::uint64_t updates = 0;
+  // Value table reads and writes, the states they stored for the first time,
+  // and the entries that map lookups compared on the way.
+  std::uint64_t lookups = 0;
+  std::uint64_t inserts = 0;
+  std::uint64_t probes = 0;
+  // Allocations through ArenaAllocator, and the ones of those and of arena
+  // blocks that reached the global allocator.
+  std::uint64_t allocations = 0;
+  std::uint64_t heap_allocations = 0;
+  double step_seconds = 0.0;
+  double policy_seconds = 0.0;
+  double update_seconds = 0.0;
+};
+
+// Returned through Game::Train. The game's own counters and timings are
+// always measured.
+struct TrainStats {
+  AgentStats first_player;
+  AgentStats second_player;
+  // The episodes played, fewer than asked for if Train stopped early, and
+  // the moves made in them.
+  int episodes = 0;
+  std::uint64_t steps = 0;
+  double initialize_seconds = 0.0;
+  double checkpoint_seconds = 0.0;
+  double total_seconds = 0.0;
+};
+
+// Adds the time until destruction to *seconds, unless it is nullptr.
+class ScopedTimer {
+ public:
+  using Clock = std::chrono::steady_clock;
+  explicit ScopedTimer(double *seconds)
+      : seconds_(seconds),
+        start_(seconds ? Clock::now() : Clock::time_point()) {}
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+  ~ScopedTimer() {
+    if (seconds_)
+      *seconds_ += std::chrono::duration<double>(Clock::now() - start_).count();
+  }
+
+ private:
+  double *seconds_;
+  Clock::time_point start_;
+};
+
+// The stats that the macros on the calling thread add to, or nullptr.
+inline AgentStats *&CurrentStats() {
+  static thread_local AgentStats *stats = nullptr;
+  return stats;
+}
+
+// Makes stats the calling thread's CurrentStats() until destroyed. Does
+// nothing without NIM_RL_STATS.
+class StatsScope {
+ public:
+#ifdef NIM_RL_STATS
+  explicit StatsScope(AgentStats *stats) : previous_(CurrentStats()) {
+    CurrentStats() = stats;
+  }
+  ~StatsScope() { CurrentStats() = previous_; }
+#else
+  explicit StatsScope(AgentStats *) {}
+#endif
+  StatsScope(const StatsScope &) = delete;
+  StatsScope &operator=(const StatsScope &) = delete;
+
+ private:
+#ifdef NIM_RL_STATS
+  AgentStats *previous_;
+#endif
+};
+
+}  // namespace nim_rl
+
+#ifdef NIM_RL_STATS
+#define NIM_RL_STATS_CONCAT_(a, b) a##b
+#define NIM_RL_STATS_CONCAT(a, b) NIM_RL_STATS_CONCAT_(a, b)
+// Adds n to the field of CurrentStats(); n is not evaluated without stats.
+#define NIM_RL_COUNT_N(field, n)                                         \
+  do {                                                                   \
+    if (::nim_rl::AgentStats *nim_rl_stats = ::nim_rl::CurrentStats())   \
+      nim_rl_stats->field += (n);                                        \
+  } while (0)
+#define NIM_RL_COUNT(field) NIM_RL_COUNT_N(field, 1)
+// Adds the time until the end of the enclosing scope to the field.
+#define NIM_RL_TIME(field)                                               \
+  ::nim_rl::ScopedTimer NIM_RL_STATS_CONCAT(nim_rl_timer_, __LINE__)(      \
+      ::nim_rl::CurrentStats() ? &::nim_rl::CurrentStats()->field : nullptr)
+#else
+#define NIM_RL_COUNT_N(field, n) \
+  do {                           \
+  } while (0)
+#define NIM_RL_COUNT(field) \
+  do {                      \
+  } while (0)
+#define NIM_RL_TIME(field) \
+  do {                     \
+  } while (0)
+#endif
+
+#endif  // NIM_RL_STATS_STATS_H_
@@ -0,0 +1,222 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/stats/tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace nim_rl {
+
+namespace internal {
+std::atomic<bool> is_tracing{false};
+}  // namespace internal
+
+namespace {
+
+constexpr auto kFlushInterval = std::chrono::milliseconds(50);
+
+struct TraceEvent {
+  const char *name;
+  const char *arg_name;
+  std::int64_t arg;
+  std::int64_t begin;
+  std::int64_t end;
+};
+
+struct ThreadBuffer;
+
+struct Trace {
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::thread flusher;
+  bool is_flushing = false;
+  std::ofstream out;
+  std::size_t buffer_size = kDefaultTraceBufferSize;
+  std::int64_t origin = 0;
+  int next_tid = 0;
+  std::vector<ThreadBuffer *> buffers;
+};
+
+// Never destroyed, so that threads exiting during static destruction may
+// still flush into it.
+Trace &GetTrace() {
+  static Trace *trace = new Trace();
+  return *trace;
+}
+
+// A ring of events that only its thread appends to and only the holder of
+// the trace mutex takes from, so appending takes no lock. Events that find
+// the ring full are dropped and counted rather than waited for.
+struct ThreadBuffer {
+  int tid = -1;
+  std::unique_ptr<TraceEvent[]> ring;
+  std::size_t capacity = 0;
+  std::atomic<std::size_t> head{0};
+  std::atomic<std::size_t> tail{0};
+  std::size_t num_dropped = 0;
+  ~ThreadBuffer();
+  void Append(const TraceEvent &event);
+  void Drain(Trace *trace);
+  void Finish(Trace *trace, std::int64_t end);
+  void Register(Trace *trace);
+};
+
+std::int64_t NowNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Appends the events taken so far to the file. Requires the trace mutex.
+void ThreadBuffer::Drain(Trace *trace) {
+  std::size_t end = head.load(std::memory_order_acquire);
+  std::size_t begin = tail.load(std::memory_order_relaxed);
+  for (; begin != end; ++begin) {
+    const TraceEvent &event = ring[begin % capacity];
+    trace->out << ",\n{\"name\":\"" << event.name
+               << "\",\"cat\":\"nim_rl\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+               << tid << ",\"ts\":" << (event.begin - trace->origin) / 1e3
+               << ",\"dur\":" << (event.end - event.begin) / 1e3;
+    if (event.arg_name)
+      trace->out << ",\"args\":{\"" << event.arg_name << "\":" << event.arg
+                 << '}';
+    trace->out << '}';
+  }
+  tail.store(end, std::memory_order_release);
+}
+
+// Drains the ring and marks the events dropped from it at end. Requires the
+// trace mutex.
+void ThreadBuffer::Finish(Trace *trace, std::int64_t end) {
+  Drain(trace);
+  if (!num_dropped) return;
+  trace->out << ",\n{\"name\":\"dropped_events\",\"ph\":\"i\",\"s\":\"t\","
+             << "\"pid\":1,\"tid\":" << tid << ",\"ts\":"
+             << (end - trace->origin) / 1e3 << ",\"args\":{\"count\":"
+             << num_dropped << "}}";
+  num_dropped = 0;
+}
+
+ThreadBuffer::~ThreadBuffer() {
+  Trace &trace = GetTrace();
+  std::lock_guard<std::mutex> lock(trace.mutex);
+  if (tid < 0) return;
+  if (internal::is_tracing) Finish(&trace, NowNanoseconds());
+  trace.buffers.erase(
+      std::find(trace.buffers.begin(), trace.buffers.end(), this));
+}
+
+void ThreadBuffer::Append(const TraceEvent &event) {
+  Trace &trace = GetTrace();
+  if (tid < 0) Register(&trace);
+  std::size_t next = head.load(std::memory_order_relaxed);
+  std::size_t size = next - tail.load(std::memory_order_acquire);
+  if (size == capacity) {
+    ++num_dropped;
+    return;
+  }
+  ring[next % capacity] = event;
+  head.store(next + 1, std::memory_order_release);
+  // Half a ring is left for the time the flusher takes to wake up.
+  if (size + 1 == capacity / 2) trace.wake.notify_one();
+}
+
+void ThreadBuffer::Register(Trace *trace) {
+  std::lock_guard<std::mutex> lock(trace->mutex);
+  tid = trace->next_tid++;
+  if (capacity != trace->buffer_size) {
+    capacity = trace->buffer_size;
+    ring.reset(new TraceEvent[capacity]);
+  }
+  head = tail = 0;
+  num_dropped = 0;
+  trace->buffers.push_back(this);
+  trace->out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+             << "\"tid\":" << tid << ",\"args\":{\"name\":\"thread "
+             << tid << "\"}}";
+}
+
+ThreadBuffer &GetThreadBuffer() {
+  thread_local ThreadBuffer buffer;
+  return buffer;
+}
+
+// Drains every ring each kFlushInterval, or sooner when one is half full,
+// so that the traced threads never write the file themselves.
+void FlushLoop(Trace *trace) {
+  std::unique_lock<std::mutex> lock(trace->mutex);
+  while (trace->is_flushing) {
+    trace->wake.wait_for(lock, kFlushInterval);
+    for (auto *buffer : trace->buffers) buffer->Drain(trace);
+  }
+}
+
+}  // namespace
+
+void StartTrace(const std::string &path, std::size_t buffer_size) {
+  Trace &trace = GetTrace();
+  std::lock_guard<std::mutex> lock(trace.mutex);
+  if (internal::is_tracing) throw std::runtime_error("A trace is running.");
+  trace.out.open(path, std::ios::trunc);
+  if (!trace.out) throw std::runtime_error("Cannot open " + path);
+  trace.out << std::fixed << std::setprecision(3);
+  trace.out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+            << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+            << "\"args\":{\"name\":\"nim_rl\"}}";
+  trace.buffer_size = std::max<std::size_t>(buffer_size, 1);
+  trace.origin = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  // Threads that traced before keep their buffers, which register again and
+  // name their threads again.
+  for (auto *buffer : trace.buffers) buffer->tid = -1;
+  trace.buffers.clear();
+  trace.next_tid = 0;
+  trace.is_flushing = true;
+  trace.flusher = std::thread(FlushLoop, &trace);
+  internal::is_tracing = true;
+}
+
+void StopTrace() {
+  Trace &trace = GetTrace();
+  {
+    std::lock_guard<std::mutex> lock(trace.mutex);
+    if (!internal::is_tracing) return;
+    internal::is_tracing = false;
+    trace.is_flushing = false;
+  }
+  trace.wake.notify_one();
+  trace.flusher.join();
+  std::lock_guard<std::mutex> lock(trace.mutex);
+  std::int64_t end = NowNanoseconds();
+  for (auto *buffer : trace.buffers) buffer->Finish(&trace, end);
+  trace.out << "\n]}\n";
+  trace.out.close();
+}
+
+std::int64_t TraceScope::Now() { return NowNanoseconds(); }
+
+void TraceScope::Record() const {
+  if (!IsTracing()) return;
+  GetThreadBuffer().Append({name_, arg_name_, arg_, begin_, Now()});
+}
+
+}  // namespace nim_rl
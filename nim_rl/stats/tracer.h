@@ -0,0 +1,84 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_STATS_TRACER_H_
+#define NIM_RL_STATS_TRACER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace nim_rl {
+
+constexpr std::size_t kDefaultTraceBufferSize = 1 << 14;
+
+// Starts recording the NIM_RL_TRACE scopes of every thread into a Chrome
+// trace file at path, which chrome://tracing and Perfetto open as one
+// timeline row per thread. Each thread collects its events in a ring of
+// buffer_size events without locking, and a background thread drains the
+// rings into the file, so the traced threads never wait for it. Events that
+// find their ring full are dropped, and their number is reported at the end
+// of the thread's row.
+void StartTrace(const std::string &path,
+                std::size_t buffer_size = kDefaultTraceBufferSize);
+
+// Stops the background thread, writes the remaining events and closes the
+// file. Call it once the traced threads are idle, for instance after
+// ThreadPool::Wait.
+void StopTrace();
+
+namespace internal {
+extern std::atomic<bool> is_tracing;
+}  // namespace internal
+
+inline bool IsTracing() {
+  return internal::is_tracing.load(std::memory_order_relaxed);
+}
+
+// Records its lifetime as an event named name, with an optional integer
+// argument. Costs a relaxed load when no trace is running. The strings must
+// outlive the trace, as literals do.
+class TraceScope {
+ public:
+  explicit TraceScope(const char *name, const char *arg_name = nullptr,
+                      std::int64_t arg = 0)
+      : name_(name), arg_name_(arg_name), arg_(arg),
+        begin_(IsTracing() ? Now() : -1) {}
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+  ~TraceScope() {
+    if (begin_ >= 0) Record();
+  }
+
+ private:
+  const char *name_;
+  const char *arg_name_;
+  std::int64_t arg_;
+  std::int64_t begin_;
+  static std::int64_t Now();
+  void Record() const;
+};
+
+}  // namespace nim_rl
+
+#define NIM_RL_TRACE_CONCAT_(a, b) a##b
+#define NIM_RL_TRACE_CONCAT(a, b) NIM_RL_TRACE_CONCAT_(a, b)
+// Traces the rest of the enclosing scope: NIM_RL_TRACE("Episode") or
+// NIM_RL_TRACE("Episode", "episode", i).
+#define NIM_RL_TRACE(...)                                          \
+  ::nim_rl::TraceScope NIM_RL_TRACE_CONCAT(nim_rl_trace_, __LINE__)( \
+      __VA_ARGS__)
+
+#endif  // NIM_RL_STATS_TRACER_H_
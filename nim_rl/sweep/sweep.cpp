@@ -0,0 +1,260 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Trains every agent of a hyperparameter grid by self-play once per seed,
+// spreading the runs over a thread pool, and writes the learning curves
+// averaged over the seeds to a CSV file as each configuration completes:
+//
+//   nim_sweep --agents=QLearningAgent,SarsaAgent --alpha=0.1,0.5
+//       --epsilon_decay_factor=0.9,0.99 --seeds=10 --episodes=50000
+//       --state=10,10,10 --threads=8 --output=sweep.csv
+//
+// Every hyperparameter an agent reports through GetHyperparameters, such as
+// alpha, gamma, epsilon, epsilon_decay_factor, min_epsilon or n, may be
+// given a list of values; the others keep their defaults. Each row holds the
+// mean over the seeds and the half width of its 95% confidence interval.
+// --trace=sweep.json also writes a Chrome trace of the runs on each thread.
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nim_rl/agent/rl_agent.h"
+#include "nim_rl/bench/agent_registry.h"
+#include "nim_rl/bench/flags.h"
+#include "nim_rl/environment/game.h"
+#include "nim_rl/stats/tracer.h"
+#include "nim_rl/thread/thread_pool.h"
+
+using namespace nim_rl;
+
+namespace {
+
+using Hyperparameters = RLAgent::Hyperparameters;
+
+struct Options {
+  std::vector<std::string> agents{"QLearningAgent"};
+  std::map<std::string, std::vector<double>> grid;
+  int episodes = 50000;
+  int seeds = 5;
+  State state{10, 10, 10};
+  int threads = 0;
+  std::string output = "sweep.csv";
+  std::string trace;
+  bool is_verbose = false;
+};
+
+struct Config {
+  std::string agent;
+  Hyperparameters hyperparameters;
+};
+
+constexpr char kUsage[] =
+    "Usage: nim_sweep [--name=value...]\n"
+    "  --agents=LIST     agents to train (QLearningAgent)\n"
+    "  --episodes=N      self-play episodes per run (50000)\n"
+    "  --seeds=N         runs per configuration (5)\n"
+    "  --state=LIST      pile sizes of the initial state (10,10,10)\n"
+    "  --threads=N       threads, 0 for one per core (0)\n"
+    "  --output=PATH     CSV file to write (sweep.csv)\n"
+    "  --trace=PATH      Chrome trace to write\n"
+    "  --verbose         report every run on stderr\n"
+    "  --NAME=LIST       values of the hyperparameter NAME, such as alpha,\n"
+    "                    gamma, epsilon, epsilon_decay_factor, min_epsilon\n"
+    "                    or n, which some of the agents must have\n";
+
+// Returns false if the usage was asked for.
+bool ParseOptions(int argc, char **argv, Options *options) {
+  bool is_parsed = ParseFlags(argc, argv, [&](const std::string &name,
+                                              const std::string &value) {
+    if (name == "agents") {
+      options->agents = ParseAgentTypes(value);
+    } else if (name == "episodes") {
+      options->episodes = ParseNumber<int>(name, value);
+    } else if (name == "seeds") {
+      options->seeds = ParseNumber<int>(name, value);
+    } else if (name == "state") {
+      options->state = ParseState(name, value);
+    } else if (name == "threads") {
+      options->threads = ParseNumber<int>(name, value);
+    } else if (name == "output") {
+      options->output = value;
+    } else if (name == "trace") {
+      options->trace = value;
+    } else if (name == "verbose") {
+      options->is_verbose = value == "true";
+    } else {
+      options->grid[name] = ParseNumbers<double>(name, value);
+    }
+  });
+  if (!is_parsed) return false;
+  if (options->episodes < 0 || options->seeds <= 0)
+    throw std::invalid_argument("Episodes must >= 0 and seeds must > 0");
+  // A misspelt hyperparameter would otherwise be skipped by every agent.
+  for (const auto &kv : options->grid) {
+    bool is_known = false;
+    for (const auto &agent : options->agents)
+      is_known |= Agents().at(agent).factory()->GetHyperparameters().count(
+          kv.first) != 0;
+    if (!is_known)
+      throw std::invalid_argument("None of the agents has hyperparameter "
+                                  + kv.first);
+  }
+  return true;
+}
+
+// The grid values of the hyperparameters the agent has, combined in every
+// way, with the defaults for the rest.
+std::vector<Config> MakeConfigs(const Options &options) {
+  std::vector<Config> configs;
+  for (const auto &agent : options.agents) {
+    std::vector<Hyperparameters> combinations{
+        Agents().at(agent).factory()->GetHyperparameters()};
+    for (const auto &kv : options.grid) {
+      if (!combinations.front().count(kv.first)) continue;
+      std::vector<Hyperparameters> next_combinations;
+      for (const auto &combination : combinations) {
+        for (double value : kv.second) {
+          next_combinations.push_back(combination);
+          next_combinations.back()[kv.first] = value;
+        }
+      }
+      combinations.swap(next_combinations);
+    }
+    for (auto &combination : combinations)
+      configs.push_back({agent, std::move(combination)});
+  }
+  return configs;
+}
+
+// The mean of the samples and the half width of its 95% confidence
+// interval, by the normal approximation.
+std::pair<double, double> MeanAndInterval(const std::vector<double> &samples) {
+  double mean = 0.0, variance = 0.0;
+  for (double sample : samples) mean += sample;
+  mean /= samples.size();
+  if (samples.size() < 2) return {mean, 0.0};
+  for (double sample : samples) variance += (sample - mean) * (sample - mean);
+  variance /= samples.size() - 1;
+  return {mean, 1.96 * std::sqrt(variance / samples.size())};
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  try {
+    if (!ParseOptions(argc, argv, &options)) {
+      std::cout << kUsage;
+      return 0;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n' << kUsage;
+    return 1;
+  }
+  std::vector<Config> configs = MakeConfigs(options);
+  std::set<std::string> names;
+  for (const auto &config : configs)
+    for (const auto &kv : config.hyperparameters) names.insert(kv.first);
+
+  std::ofstream out(options.output);
+  if (!out) {
+    std::cerr << "Cannot write " << options.output << std::endl;
+    return 1;
+  }
+  out << "agent";
+  for (const auto &name : names) out << ',' << name;
+  out << ",episode,seeds,optimal_actions_ratio,optimal_actions_ratio_ci95,"
+         "mean_square_error,mean_square_error_ci95" << std::endl;
+
+  using Curves = std::pair<std::vector<double>, std::vector<double>>;
+  std::vector<std::vector<Curves>> results(
+      configs.size(), std::vector<Curves>(options.seeds));
+  std::unique_ptr<std::atomic<int>[]> num_remaining(
+      new std::atomic<int>[configs.size()]);
+  for (std::size_t i = 0; i != configs.size(); ++i)
+    num_remaining[i] = options.seeds;
+  std::mutex output_mutex;
+
+  auto write_config = [&](std::size_t index) {
+    const Config &config = configs[index];
+    std::lock_guard<std::mutex> lock(output_mutex);
+    std::size_t num_checkpoints = results[index].front().first.size();
+    for (std::size_t ckpt = 0; ckpt != num_checkpoints; ++ckpt) {
+      std::vector<double> ratios, errors;
+      for (const auto &curves : results[index]) {
+        ratios.push_back(curves.first[ckpt]);
+        errors.push_back(curves.second[ckpt]);
+      }
+      auto ratio = MeanAndInterval(ratios), error = MeanAndInterval(errors);
+      out << config.agent;
+      for (const auto &name : names) {
+        out << ',';
+        auto iter = config.hyperparameters.find(name);
+        if (iter != config.hyperparameters.end()) out << iter->second;
+      }
+      out << ',' << ckpt * kCheckPoint << ',' << options.seeds << ','
+          << ratio.first << ',' << ratio.second << ',' << error.first << ','
+          << error.second << '\n';
+    }
+    out.flush();
+  };
+
+  ThreadPool pool(options.threads);
+  if (!options.trace.empty()) StartTrace(options.trace);
+  if (options.is_verbose)
+    std::cerr << configs.size() << " configurations x " << options.seeds
+              << " seeds on " << pool.NumThreads() << " threads" << std::endl;
+  for (std::size_t index = 0; index != configs.size(); ++index) {
+    for (int seed = 0; seed != options.seeds; ++seed) {
+      pool.Submit([&, index, seed] {
+        const Config &config = configs[index];
+        NIM_RL_TRACE("Run", "config", static_cast<std::int64_t>(index));
+        std::shared_ptr<RLAgent> agent =
+            Agents().at(config.agent).factory();
+        agent->SetHyperparameters(config.hyperparameters);
+        Game game(options.state);
+        game.SetSeed(static_cast<std::uint64_t>(seed));
+        game.SetVerbose(false);
+        game.SetFirstPlayer(*agent);
+        game.SetSecondPlayer(*agent);
+        results[index][seed] = game.Train(options.episodes);
+        if (options.is_verbose) {
+          std::lock_guard<std::mutex> lock(output_mutex);
+          std::cerr << config.agent << " #" << index << " seed " << seed
+                    << ": " << results[index][seed].first.back() << std::endl;
+        }
+        if (!--num_remaining[index]) write_config(index);
+      });
+    }
+  }
+  try {
+    pool.Wait();
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    StopTrace();
+    return 1;
+  }
+  StopTrace();
+  return 0;
+}
@@ -0,0 +1,176 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Counts the heap allocations that each agent makes per step and per episode
+// of self-play once training has warmed up, prints them as a table, and
+// fails if an agent allocates more per step than its budget. The goal is no
+// allocation per step; the agents with a nonzero budget still copy states
+// per step, as children (expected SARSA, double Q-learning) or into their
+// trajectories (n-step and Monte Carlo), and their budgets only guard
+// against regressions. Budgets may be overridden on the command line:
+//
+//   nim_alloc_test QLearningAgent=0 SarsaAgent=2.5
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nim_rl/agent/optimal_agent.h"
+#include "nim_rl/agent/random_agent.h"
+#include "nim_rl/bench/agent_registry.h"
+#include "nim_rl/bench/alloc_counter.h"
+#include "nim_rl/environment/game.h"
+
+using namespace nim_rl;
+
+namespace {
+
+constexpr int kWarmUpEpisodes = 2000;
+constexpr int kEpisodes = 1000;
+
+struct Budget {
+  std::string agent;
+  // Allocations per step.
+  double budget;
+};
+
+std::vector<Budget> Budgets() {
+  return {{"OptimalAgent", 0},
+          {"RandomAgent", 0},
+          {"PolicyIterationAgent", 0},
+          {"ValueIterationAgent", 0},
+          {"QLearningAgent", 0},
+          {"SarsaAgent", 0},
+          {"ExpectedSarsaAgent", 7},
+          {"DoubleQLearningAgent", 1},
+          {"DoubleSarsaAgent", 0},
+          {"DoubleExpectedSarsaAgent", 7},
+          {"NStepSarsaAgent", 2},
+          {"NStepExpectedSarsaAgent", 9},
+          {"OffPolicyNStepSarsaAgent", 3},
+          {"OffPolicyNStepExpectedSarsaAgent", 10},
+          {"NStepTreeBackupAgent", 2},
+          {"ESMonteCarloAgent", 4},
+          {"OnPolicyMonteCarloAgent", 4},
+          {"OffPolicyMonteCarloAgent", 2}};
+}
+
+// The RL agents come from the registry.
+std::shared_ptr<Agent> MakeAgent(const std::string &type) {
+  if (type == "OptimalAgent") return std::make_shared<OptimalAgent>();
+  if (type == "RandomAgent") return std::make_shared<RandomAgent>();
+  return Agents().at(type).factory();
+}
+
+struct Usage {
+  double allocations_per_step = 0.0;
+  double bytes_per_step = 0.0;
+  std::size_t max_allocations_per_step = 0;
+  double allocations_per_episode = 0.0;
+};
+
+// Self-play as Game::Train plays it, after Train has initialized the agent
+// and warmed up its values, arena and buffers.
+Usage Measure(const Agent &agent) {
+  Game game(State({10, 10, 10}));
+  game.SetSeed(0);
+  game.SetVerbose(false);
+  game.SetFirstPlayer(agent);
+  game.SetSecondPlayer(agent);
+  game.Train(kWarmUpEpisodes);
+  Agent *players[] = {game.GetFirstPlayer().get(),
+                      game.GetSecondPlayer().get()};
+  Usage usage;
+  std::size_t num_steps = 0, step_allocations = 0, step_bytes = 0;
+  auto step = [&](int player) {
+    AllocCounts counts = GetAllocCounts();
+    players[player]->Step(&game, false);
+    std::size_t allocations =
+        GetAllocCounts().num_allocations - counts.num_allocations;
+    ++num_steps;
+    step_allocations += allocations;
+    step_bytes += GetAllocCounts().num_bytes - counts.num_bytes;
+    usage.max_allocations_per_step =
+        std::max(usage.max_allocations_per_step, allocations);
+  };
+  SeedRandomEngine(0);
+  game.Reset();
+  std::size_t allocations = GetAllocCounts().num_allocations;
+  for (int i = 0; i < kEpisodes; ++i) {
+    int player = 0;
+    do {
+      step(player);
+      player = 1 - player;
+    } while (!game.IsTerminal());
+    // The loser observes the end of the game.
+    step(player);
+    game.Reset();
+  }
+  usage.allocations_per_step =
+      static_cast<double>(step_allocations) / num_steps;
+  usage.bytes_per_step = static_cast<double>(step_bytes) / num_steps;
+  usage.allocations_per_episode =
+      static_cast<double>(GetAllocCounts().num_allocations - allocations)
+      / kEpisodes;
+  return usage;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::vector<Budget> budgets = Budgets();
+  for (int i = 1; i != argc; ++i) {
+    std::string arg = argv[i];
+    std::size_t equal = arg.find('=');
+    auto iter = std::find_if(budgets.begin(), budgets.end(),
+                             [&](const Budget &budget) {
+                               return budget.agent == arg.substr(0, equal);
+                             });
+    if (equal == std::string::npos || iter == budgets.end()) {
+      std::cerr << "Expected <agent>=<allocations per step>, got " << arg
+                << std::endl;
+      return 2;
+    }
+    iter->budget = std::stod(arg.substr(equal + 1));
+  }
+  std::cout << std::left << std::setw(34) << "agent" << std::right
+            << std::setw(12) << "allocs/step" << std::setw(12) << "bytes/step"
+            << std::setw(10) << "max/step" << std::setw(16) << "allocs/episode"
+            << std::setw(9) << "budget" << std::endl;
+  int num_failures = 0;
+  for (const auto &budget : budgets) {
+    std::shared_ptr<Agent> agent = MakeAgent(budget.agent);
+    // The DP agents report their sweeps while they initialize.
+    std::streambuf *cout_buffer = std::cout.rdbuf(nullptr);
+    Usage usage = Measure(*agent);
+    std::cout.rdbuf(cout_buffer);
+    std::cout.clear();
+    bool is_over = usage.allocations_per_step > budget.budget;
+    num_failures += is_over;
+    std::cout << std::left << std::setw(34) << budget.agent << std::right
+              << std::fixed << std::setprecision(2)
+              << std::setw(12) << usage.allocations_per_step
+              << std::setw(12) << usage.bytes_per_step
+              << std::setw(10) << usage.max_allocations_per_step
+              << std::setw(16) << usage.allocations_per_episode
+              << std::setw(9) << budget.budget
+              << (is_over ? "  OVER BUDGET" : "") << std::endl;
+  }
+  return num_failures ? 1 : 0;
+}
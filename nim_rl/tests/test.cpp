@@ -20,7 +20,14 @@
 #include "nim_rl/agent/random_agent.h"
 #include "nim_rl/agent/td_agent.h"
 #include "nim_rl/environment/game.h"
+#include "nim_rl/environment/offline_trainer.h"
+#include "nim_rl/environment/typed_game.h"
+#include "nim_rl/evaluation/evaluator.h"
+#include "nim_rl/random/rng.h"
 #include "nim_rl/state/state.h"
+#include "nim_rl/state/state_batch.h"
+#include "nim_rl/state/state_range.h"
+#include "nim_rl/stats/tracer.h"
 
 using namespace nim_rl;
 
@@ -247,8 +254,7 @@ void NStepTest() {
 
 void ValueFunctionSizesTest() {
   for (int num_pile = 1; num_pile <= 10; ++num_pile) {
-    Game game(State(num_pile, 10));
-    std::cout << game.GetAllStates().size() << std::endl;
+    std::cout << State(num_pile, 10).CountStates() << std::endl;
   }
 }
 
@@ -272,7 +278,259 @@ void StateSpaceTest() {
   }
 }
 
+// The cache holds a small part of the 286 states, so most values are read
+// back from the narrowed array.
+void ValuePrecisionTest() {
+  State state({10, 10, 10});
+  for (Precision precision : {Precision::kFloat64, Precision::kFloat32,
+                              Precision::kFloat16, Precision::kInt8}) {
+    Game game(state);
+    QLearningAgent ql_agent;
+    ql_agent.CompactValues(state, precision, 16);
+    std::cout << "Testing Q Learning with precision: "
+              << static_cast<int>(precision) << std::endl;
+    game.SetSeed(0);
+    game.SetVerbose(false);
+    game.SetFirstPlayer(ql_agent);
+    game.SetSecondPlayer(ql_agent);
+    game.Train(100000);
+    auto *trained_agent =
+        static_cast<QLearningAgent *>(game.GetFirstPlayer().get());
+    std::cout << "Optimal actions ratio: "
+              << trained_agent->OptimalActionsRatio()
+              << ", min square error: " << trained_agent->MinSquareError()
+              << std::endl;
+  }
+}
+
+void OfflineTest() {
+  Game game(State({10, 10, 10}));
+  QLearningAgent ql_agent;
+  game.SetFirstPlayer(ql_agent);
+  game.SetSecondPlayer(ql_agent);
+  game.SetTrajectoryLog(std::make_shared<TrajectoryWriter>("self_play.log"));
+  game.Train(100000);
+  game.GetTrajectoryLog()->Close();
+  OfflineTrainer trainer("self_play.log");
+  for (int epochs = 1; epochs <= 3; ++epochs) {
+    QLearningAgent offline_agent;
+    trainer.Train(&offline_agent, epochs);
+    std::cout << "Offline Q Learning after " << epochs << " epochs: "
+              << offline_agent.OptimalActionsRatio() << std::endl;
+  }
+}
+
+void SeedTest() {
+  for (int run = 0; run != 2; ++run) {
+    Game game(State({10, 10, 10}));
+    DoubleQLearningAgent double_ql_agent;
+    game.SetSeed(42);
+    game.SetVerbose(false);
+    game.SetFirstPlayer(double_ql_agent);
+    game.SetSecondPlayer(double_ql_agent);
+    std::cout << "Double Q Learning with seed 42, run " << run + 1 << ": "
+              << game.Train(10000).first.back() << std::endl;
+  }
+}
+
+void StatsTest() {
+  Game game(State({10, 10, 10}));
+  NStepSarsaAgent n_step_sarsa_agent(0.5, 1.0, 2);
+  game.SetVerbose(false);
+  game.SetFirstPlayer(n_step_sarsa_agent);
+  game.SetSecondPlayer(n_step_sarsa_agent);
+  TrainStats stats;
+  game.Train(10000, &stats);
+  const AgentStats &first = stats.first_player;
+  std::cout << "Steps: " << first.steps << ", updates: " << first.updates
+            << ", lookups: " << first.lookups << ", inserts: "
+            << first.inserts << ", probes: " << first.probes
+            << ", allocations: " << first.allocations << " ("
+            << first.heap_allocations << " on the heap)" << std::endl;
+  std::cout << "Policy: " << first.policy_seconds << "s, update: "
+            << first.update_seconds << "s, checkpoints: "
+            << stats.checkpoint_seconds << "s, total: "
+            << stats.total_seconds << "s" << std::endl;
+}
+
+void TraceTest() {
+  StartTrace("train_trace.json");
+  Game game(State({10, 10, 10}));
+  ValueIterationAgent value_iteration_agent;
+  OptimalAgent optimal_agent;
+  game.SetFirstPlayer(value_iteration_agent);
+  game.SetSecondPlayer(optimal_agent);
+  game.Train();
+  QLearningAgent ql_agent;
+  game.SetFirstPlayer(ql_agent);
+  game.SetSecondPlayer(ql_agent);
+  game.Train(10000);
+  StopTrace();
+  std::cout << "Open train_trace.json in chrome://tracing or Perfetto."
+            << std::endl;
+}
+
+void StopRatioTest() {
+  Game game(State({10, 10, 10}));
+  QLearningAgent ql_agent;
+  game.SetSeed(0);
+  game.SetStopRatio(0.99);
+  game.SetVerbose(false);
+  game.SetFirstPlayer(ql_agent);
+  game.SetSecondPlayer(ql_agent);
+  TrainStats stats;
+  auto optimal_action_ratios = game.Train(200000, &stats).first;
+  std::cout << "Reached " << optimal_action_ratios.back() << " after "
+            << stats.episodes << " episodes, " << stats.steps << " steps and "
+            << stats.total_seconds - stats.checkpoint_seconds << "s"
+            << std::endl;
+}
+
+// The agents are constructed apart, since the clones of one agent share its
+// value table.
+void TypedGameTest() {
+  QLearningAgent ql_agent, typed_ql_agent;
+  Game game(State({10, 10, 10}), ql_agent, ql_agent);
+  TypedGame<QLearningAgent, QLearningAgent> typed_game(
+      State({10, 10, 10}), typed_ql_agent, typed_ql_agent);
+  game.SetSeed(0);
+  game.SetVerbose(false);
+  typed_game.SetSeed(0);
+  typed_game.SetVerbose(false);
+  auto curves = game.Train(10000);
+  auto typed_curves = typed_game.Train(10000);
+  std::cout << "Identical learning curves: " << std::boolalpha
+            << (curves == typed_curves) << ", values: "
+            << (std::dynamic_pointer_cast<RLAgent>(game.GetFirstPlayer())
+                    ->GetValues()
+                == typed_game.GetFirstPlayer()->GetValues())
+            << std::endl;
+}
+
+// Checks the StateBatch kernels, vectorized for whatever the build targets,
+// against the scalar State functions on random unsorted states. The batch is
+// not a multiple of any vector width, so the scalar tails run too, and some
+// piles exceed INT_MAX to catch signed comparisons.
+void StateBatchTest() {
+  SeedRandomEngine(0);
+  std::vector<State> states;
+  std::vector<Action> actions;
+  for (int i = 0; i != 1003; ++i) {
+    std::uint64_t bound = i % 5 == 0 ? 1ull << 32 : i % 3 == 0 ? 2 : 64;
+    State state(4, 0);
+    for (int pile_id = 0; pile_id != state.Size(); ++pile_id)
+      state[pile_id] = static_cast<unsigned>(RandomEngine().Bounded(bound));
+    states.push_back(state);
+    actions.emplace_back(static_cast<int>(RandomEngine().Bounded(5)),
+                         static_cast<int>(RandomEngine().Bounded(64)));
+  }
+  StateBatch batch(states), children;
+  std::vector<std::size_t> hashes;
+  std::vector<unsigned char> is_terminal;
+  std::vector<unsigned> nim_sums;
+  std::vector<Action> policy_actions;
+  batch.Hash(&hashes);
+  batch.IsTerminal(&is_terminal);
+  batch.NimSum(&nim_sums);
+  batch.Child(actions, &children);
+  StateBatch canonical(batch);
+  canonical.Canonicalize();
+  StateBatch small_states;
+  for (const auto &state : states)
+    if (state.NimSum() && state[0] < 64 && state[1] < 64 && state[2] < 64
+        && state[3] < 64)
+      small_states.PushBack(state);
+  OptimalAgent optimal_agent;
+  optimal_agent.Policy(small_states, &policy_actions);
+  bool is_hash_equal = true, is_terminal_equal = true,
+      is_nim_sum_equal = true, is_child_equal = true,
+      is_canonical_equal = true, is_policy_equal = true;
+  for (std::size_t i = 0; i != states.size(); ++i) {
+    const State &state = states[i];
+    is_hash_equal &= hashes[i] == std::hash<State>()(state);
+    is_terminal_equal &= static_cast<bool>(is_terminal[i])
+        == state.IsTerminal();
+    is_nim_sum_equal &= nim_sums[i] == state.NimSum();
+    // A batch has no empty state for the child of a terminal state.
+    State child = children.Get(i),
+        expected_child = state.IsTerminal() ? state : state.Child(actions[i]);
+    for (int pile_id = 0; pile_id != state.Size(); ++pile_id)
+      is_child_equal &= child[pile_id] == expected_child[pile_id];
+    State sorted = canonical.Get(i);
+    std::vector<unsigned> expected_sorted{state[0], state[1], state[2],
+                                          state[3]};
+    std::sort(expected_sorted.begin(), expected_sorted.end());
+    for (int pile_id = 0; pile_id != state.Size(); ++pile_id)
+      is_canonical_equal &= sorted[pile_id] == expected_sorted[pile_id];
+  }
+  for (std::size_t i = 0; i != small_states.Size(); ++i)
+    is_policy_equal &= policy_actions[i]
+        == optimal_agent.Policy(small_states.Get(i), true);
+  std::cout << std::boolalpha << "StateBatch matches State: Hash "
+            << is_hash_equal << ", IsTerminal " << is_terminal_equal
+            << ", NimSum " << is_nim_sum_equal << ", Child " << is_child_equal
+            << ", Canonicalize " << is_canonical_equal << ", Policy "
+            << is_policy_equal << std::endl;
+  if (!(is_hash_equal && is_terminal_equal && is_nim_sum_equal
+        && is_child_equal && is_canonical_equal && is_policy_equal))
+    throw std::logic_error("StateBatch kernels disagree with State");
+}
+
+void StateRangeSplitTest() {
+  bool is_covered = true;
+  for (const State &initial_state :
+       {State({7}), State({5, 5, 5}), State({1, 2, 3, 4})}) {
+    StateRange state_range(initial_state);
+    std::vector<State> states(state_range.begin(), state_range.end());
+    for (StateRange::Rank num_parts = 1; num_parts <= state_range.Size() + 2;
+         ++num_parts) {
+      std::vector<StateRange> parts =
+          state_range.Split(static_cast<int>(num_parts));
+      std::vector<State> split_states;
+      StateRange::Rank rank = state_range.GetBeginRank();
+      for (const auto &part : parts) {
+        is_covered = is_covered && part.GetBeginRank() == rank;
+        rank = part.GetEndRank();
+        for (auto iter = part.begin(); iter != part.end(); ++iter) {
+          is_covered = is_covered && *iter == part.Unrank(iter.GetRank());
+          split_states.push_back(*iter);
+        }
+      }
+      is_covered = is_covered && parts.size() == num_parts
+          && rank == state_range.GetEndRank() && split_states == states;
+    }
+  }
+  std::cout << "Split ranges cover the states once: " << is_covered
+            << std::endl;
+  if (!is_covered)
+    throw std::logic_error("Split ranges do not cover the states once");
+}
+
+void EvaluatorTest() {
+  State state({10, 10, 10});
+  Game game(state);
+  QLearningAgent ql_agent;
+  OptimalAgent optimal_agent;
+  RandomAgent random_agent;
+  game.SetSeed(0);
+  game.SetVerbose(false);
+  game.SetFirstPlayer(ql_agent);
+  game.SetSecondPlayer(ql_agent);
+  game.Train(10000);
+  Agent *trained_agent = game.GetFirstPlayer().get();
+  Evaluator evaluator(0);
+  std::cout << "Win probability against OptimalAgent: "
+            << evaluator.Evaluate(state, trained_agent, &optimal_agent)
+                   .WinProbability(state)
+            << ", against RandomAgent: "
+            << evaluator.Evaluate(state, trained_agent, &random_agent)
+                   .WinProbability(state)
+            << std::endl;
+}
+
 int main() {
+  StateBatchTest();
+  StateRangeSplitTest();
   Game game(State({5, 5, 5}));
   HumanAgent human_agent;
   OptimalAgent optimal_agent;
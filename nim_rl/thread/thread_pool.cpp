@@ -0,0 +1,120 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nim_rl/thread/thread_pool.h"
+
+#include <algorithm>
+
+namespace nim_rl {
+
+namespace {
+
+// The pool and queue of the calling thread, if it is a pool thread.
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local std::size_t current_queue = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(int num_threads) {
+  if (num_threads <= 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 0; i != num_threads; ++i)
+    queues_.emplace_back(new Queue);
+  for (int i = 0; i != num_threads; ++i)
+    threads_.emplace_back(&ThreadPool::Run, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  has_task_.notify_all();
+  for (auto &thread : threads_) thread.join();
+}
+
+void ThreadPool::Submit(Task task) {
+  std::size_t index;
+  // Counted before it is queued, so that it is never popped or finished
+  // uncounted. A thread woken in between retries until the task is queued.
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    index = current_pool == this ? current_queue
+                                 : next_queue_++ % queues_.size();
+    ++num_unfinished_;
+    ++num_queued_;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(task));
+  }
+  has_task_.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  is_idle_.wait(lock, [this] { return !num_unfinished_; });
+  if (exception_) {
+    std::exception_ptr exception = exception_;
+    exception_ = nullptr;
+    std::rethrow_exception(exception);
+  }
+}
+
+void ThreadPool::Run(std::size_t index) {
+  current_pool = this;
+  current_queue = index;
+  while (true) {
+    Task task;
+    if (TryPop(index, &task)) {
+      std::exception_ptr exception;
+      try {
+        task();
+      } catch (...) {
+        exception = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (exception && !exception_) exception_ = exception;
+      if (!--num_unfinished_) is_idle_.notify_all();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    has_task_.wait(lock, [this] { return is_stopping_ || num_queued_; });
+    if (is_stopping_ && !num_queued_) return;
+  }
+}
+
+bool ThreadPool::TryPop(std::size_t index, Task *task) {
+  bool is_found = false;
+  for (std::size_t i = 0; i != queues_.size() && !is_found; ++i) {
+    Queue &queue = *queues_[(index + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) continue;
+    if (!i) {
+      *task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    } else {
+      *task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+    is_found = true;
+  }
+  if (is_found) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --num_queued_;
+  }
+  return is_found;
+}
+
+}  // namespace nim_rl
@@ -0,0 +1,72 @@
+// Copyright 2020 Zhou Zikang. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NIM_RL_THREAD_THREAD_POOL_H_
+#define NIM_RL_THREAD_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nim_rl {
+
+// Runs tasks on a fixed set of threads. Each thread has its own queue, which
+// it runs in order; once the queue is empty it steals the newest task of
+// another thread, so uneven tasks such as training runs of different lengths
+// keep every thread busy.
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+  // Starts num_threads threads, or one per hardware thread if it is 0.
+  explicit ThreadPool(int num_threads = 0);
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  // Finishes the submitted tasks before the threads exit.
+  ~ThreadPool();
+  int NumThreads() const { return static_cast<int>(threads_.size()); }
+  // Queues the task on the calling thread if it belongs to the pool, or on
+  // the threads in turn otherwise.
+  void Submit(Task task);
+  // Blocks until every submitted task has finished, then rethrows the first
+  // exception a task threw, if any.
+  void Wait();
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable has_task_;
+  std::condition_variable is_idle_;
+  std::size_t num_queued_ = 0;
+  std::size_t num_unfinished_ = 0;
+  std::size_t next_queue_ = 0;
+  bool is_stopping_ = false;
+  std::exception_ptr exception_;
+  void Run(std::size_t index);
+  bool TryPop(std::size_t index, Task *task);
+};
+
+}  // namespace nim_rl
+
+#endif  // NIM_RL_THREAD_THREAD_POOL_H_